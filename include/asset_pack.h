@@ -0,0 +1,165 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Every asset the game loads, baked by build/packer into one file that is
+// mapped at startup. Layout:
+//   AssetPackHeader
+//   AssetPackEntry[entryCount]
+//   payloads, each starting on a 16 byte boundary
+// Textures are RGBA8 already resampled to the sprite layer size, shaders are
+// NUL-terminated source and sounds are interleaved f32 PCM. Bump
+// ASSET_PACK_VERSION whenever the layout or a payload encoding changes; the
+// game ignores packs of another version and loads the loose files instead.
+static const char ASSET_PACK_MAGIC[4] = {'P', 'M', 'P', 'K'};
+static const uint32_t ASSET_PACK_VERSION = 1;
+
+enum AssetType : uint32_t
+{
+  ASSET_TEXTURE = 1,
+  ASSET_SHADER = 2,
+  ASSET_SOUND = 3
+};
+
+struct AssetPackHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t reserved;
+};
+
+struct AssetPackEntry
+{
+  char name[64]; // the relative path the asset was packed from
+  uint32_t type;
+  uint32_t width, height;        // textures
+  uint32_t channels, sampleRate; // sounds
+  uint32_t reserved;
+  uint64_t frameCount; // sounds
+  uint64_t offset;     // from the start of the file
+  uint64_t size;
+};
+
+// Read-only view of a pack file through one mmap. Payload pointers stay valid
+// until Close, so GL uploads and audio buffers can read straight from them.
+struct AssetPack
+{
+  const unsigned char *mapping = nullptr;
+  size_t mappingSize = 0;
+
+  AssetPack() {}
+  AssetPack(const AssetPack &) = delete;
+  AssetPack &operator=(const AssetPack &) = delete;
+  ~AssetPack() { Close(); }
+
+  bool Open(const char *path);
+  void Close();
+  bool isOpen() const { return mapping != nullptr; }
+
+  const AssetPackHeader &header() const { return *(const AssetPackHeader *)mapping; }
+  const AssetPackEntry *entries() const { return (const AssetPackEntry *)(mapping + sizeof(AssetPackHeader)); }
+
+  // the entry packed from path with the given type, or null
+  const AssetPackEntry *Find(const char *path, AssetType type) const;
+  const void *Data(const AssetPackEntry &entry) const { return mapping + entry.offset; }
+};
+
+bool AssetPack::Open(const char *path)
+{
+  Close();
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(AssetPackHeader))
+  {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  mapping = (const unsigned char *)data;
+  mappingSize = info.st_size;
+
+  const AssetPackHeader &h = header();
+  if (memcmp(h.magic, ASSET_PACK_MAGIC, 4) != 0 || h.version != ASSET_PACK_VERSION)
+  {
+    printf("Ignoring asset pack %s: not a version %u pack\n", path, ASSET_PACK_VERSION);
+    Close();
+    return false;
+  }
+  size_t tableEnd = sizeof(AssetPackHeader) + (size_t)h.entryCount * sizeof(AssetPackEntry);
+  bool valid = tableEnd <= mappingSize;
+  for (uint32_t i = 0; valid && i < h.entryCount; i++)
+  {
+    const AssetPackEntry &entry = entries()[i];
+    valid = entry.offset >= tableEnd && entry.offset <= mappingSize && entry.size <= mappingSize - entry.offset &&
+            memchr(entry.name, 0, sizeof(entry.name)) != NULL;
+  }
+  if (!valid)
+  {
+    printf("Ignoring asset pack %s: truncated or corrupt\n", path);
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void AssetPack::Close()
+{
+  if (mapping)
+    munmap((void *)mapping, mappingSize);
+  mapping = nullptr;
+  mappingSize = 0;
+}
+
+const AssetPackEntry *AssetPack::Find(const char *path, AssetType type) const
+{
+  if (!mapping)
+    return nullptr;
+  for (uint32_t i = 0; i < header().entryCount; i++)
+  {
+    const AssetPackEntry &entry = entries()[i];
+    if (entry.type == type && strcmp(entry.name, path) == 0)
+      return &entry;
+  }
+  return nullptr;
+}
+
+// Resamples an RGBA8 image to a size x size sprite layer: box filter down,
+// nearest neighbour up. Shared by the packer and TextureArray so a packed
+// layer is byte-identical to one decoded at startup.
+void resampleRGBA(const unsigned char *src, int width, int height, unsigned char *dst, int size)
+{
+  for (int y = 0; y < size; y++)
+  {
+    int y0 = y * height / size;
+    int y1 = std::max(y0 + 1, (y + 1) * height / size);
+    for (int x = 0; x < size; x++)
+    {
+      int x0 = x * width / size;
+      int x1 = std::max(x0 + 1, (x + 1) * width / size);
+      unsigned int sum[4] = {0, 0, 0, 0};
+      for (int sy = y0; sy < y1; sy++)
+        for (int sx = x0; sx < x1; sx++)
+          for (int c = 0; c < 4; c++)
+            sum[c] += src[(sy * width + sx) * 4 + c];
+      unsigned int count = (y1 - y0) * (x1 - x0);
+      for (int c = 0; c < 4; c++)
+        dst[(y * size + x) * 4 + c] = (unsigned char)(sum[c] / count);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include "tile_grid.h"
+
+// 1024-bit set over a 32x32 board, row y in bits [32 * y, 32 * y + 32), so
+// two rows per 64-bit word. Whole-board operations are a handful of word ops
+// over a fixed array, which the compiler unrolls and vectorizes.
+struct Bitboard
+{
+  static constexpr int SIZE = 32;
+  static constexpr int WORDS = SIZE * SIZE / 64;
+
+  uint64_t words[WORDS] = {};
+
+  static bool Fits(int width, int height) { return width <= SIZE && height <= SIZE; }
+
+  // cells of the grid with any of flags set; the grid must fit
+  static Bitboard FromTiles(const TileGrid &tiles, uint8_t flags)
+  {
+    Bitboard board;
+    for (int y = 0; y < tiles.height; y++)
+      for (int x = 0; x < tiles.width; x++)
+        if (tiles.cells[y * tiles.width + x] & flags)
+          board.set({x, y});
+    return board;
+  }
+
+  static int bitIndex(glm::ivec2 cell) { return cell.y * SIZE + cell.x; }
+  static bool inBounds(glm::ivec2 cell)
+  {
+    return cell.x >= 0 && cell.y >= 0 && cell.x < SIZE && cell.y < SIZE;
+  }
+
+  bool test(glm::ivec2 cell) const
+  {
+    if (!inBounds(cell))
+      return false;
+    int i = bitIndex(cell);
+    return (words[i >> 6] >> (i & 63)) & 1;
+  }
+  void set(glm::ivec2 cell)
+  {
+    if (!inBounds(cell))
+      return;
+    int i = bitIndex(cell);
+    words[i >> 6] |= 1ull << (i & 63);
+  }
+  void reset(glm::ivec2 cell)
+  {
+    if (!inBounds(cell))
+      return;
+    int i = bitIndex(cell);
+    words[i >> 6] &= ~(1ull << (i & 63));
+  }
+
+  int count() const
+  {
+    int total = 0;
+    for (int i = 0; i < WORDS; i++)
+      total += __builtin_popcountll(words[i]);
+    return total;
+  }
+  bool any() const
+  {
+    uint64_t bits = 0;
+    for (int i = 0; i < WORDS; i++)
+      bits |= words[i];
+    return bits != 0;
+  }
+
+  Bitboard operator&(const Bitboard &o) const
+  {
+    Bitboard r;
+    for (int i = 0; i < WORDS; i++)
+      r.words[i] = words[i] & o.words[i];
+    return r;
+  }
+  Bitboard operator|(const Bitboard &o) const
+  {
+    Bitboard r;
+    for (int i = 0; i < WORDS; i++)
+      r.words[i] = words[i] | o.words[i];
+    return r;
+  }
+  // cells in this board but not in o
+  Bitboard without(const Bitboard &o) const
+  {
+    Bitboard r;
+    for (int i = 0; i < WORDS; i++)
+      r.words[i] = words[i] & ~o.words[i];
+    return r;
+  }
+
+  // the board of cells whose neighbour in direction dir is in this board,
+  // i.e. result(x, y) = this(x + dir.x, y + dir.y)
+  Bitboard neighbors(glm::ivec2 dir) const
+  {
+    // bits that would wrap from one row into the next
+    static const uint64_t ROW_LAST = 0x8000000080000000ull;
+    static const uint64_t ROW_FIRST = 0x0000000100000001ull;
+    Bitboard r;
+    if (dir.x == 1)
+      for (int i = 0; i < WORDS; i++)
+        r.words[i] = (words[i] >> 1) & ~ROW_LAST;
+    else if (dir.x == -1)
+      for (int i = 0; i < WORDS; i++)
+        r.words[i] = (words[i] << 1) & ~ROW_FIRST;
+    else if (dir.y == 1)
+      for (int i = 0; i < WORDS; i++)
+        r.words[i] = (words[i] >> 32) | (i + 1 < WORDS ? words[i + 1] << 32 : 0);
+    else if (dir.y == -1)
+      for (int i = 0; i < WORDS; i++)
+        r.words[i] = (words[i] << 32) | (i > 0 ? words[i - 1] >> 32 : 0);
+    return r;
+  }
+
+  // one BFS step: every cell of mask that is this board or next to it
+  Bitboard expand(const Bitboard &mask) const
+  {
+    Bitboard r = *this | neighbors({1, 0}) | neighbors({-1, 0}) | neighbors({0, 1}) | neighbors({0, -1});
+    return r & mask;
+  }
+
+  // calls fn(cell) for every set bit, lowest index first
+  template <typename Fn>
+  void forEach(Fn fn) const
+  {
+    for (int i = 0; i < WORDS; i++)
+    {
+      uint64_t bits = words[i];
+      while (bits)
+      {
+        int bit = __builtin_ctzll(bits);
+        int index = i * 64 + bit;
+        fn(glm::ivec2(index % SIZE, index / SIZE));
+        bits &= bits - 1;
+      }
+    }
+  }
+};
+
+#endif
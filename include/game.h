@@ -7,224 +7,97 @@
 #include <string>
 #include <glm/glm.hpp>
 #include "utils.h"
-#include <queue>
-#include <map>
+#include "simulation.h"
+#include "sprite_batch.h"
+#include "sprite_scene.h"
+#include "uniform_buffer.h"
+#include "texture_array.h"
+#include "asset_pack.h"
+#include "sound_bank.h"
 #include "miniaudio.h"
 
-enum GAME_STATE
+// how eaten pellets and fruit disappear from the baked board
+enum BoardRenderMode
 {
-  GAME_ACTIVE,
-  GAME_MENU,
-  GAME_WIN
+  BOARD_PATCHED_INSTANCES,  // hide the item's instance with a one-element buffer patch
+  BOARD_VISIBILITY_TEXTURE, // clear the cell's texel in an R8 mask the fragment shader discards by
 };
 
-enum GhostMode
+struct Game : Simulation
 {
-  SCATTER,
-  CHASE,
-  FRIGHTENED,
-  EATEN
-};
-enum GhostType
-{
-  BLINKY,
-  PINKY,
-  INKY,
-  CLYDE
-};
-
-// ghost type to symbol mapping
-std::map<GhostType, char> ghostTypeToSymbol = {
-    {BLINKY, 'B'},
-    {PINKY, 'P'},
-    {INKY, 'I'},
-    {CLYDE, 'C'}};
-
-struct Ghost
-{
-  glm::vec2 position;
-  glm::vec2 direction;
-  glm::vec2 velocity;
-  float speed;
-  unsigned int texture;
-  GhostMode mode;
-  glm::vec2 targetTile;
-  glm::ivec2 scatterCorner;
-  GhostType type;
-  char ghostSymbol;
-
-  glm::vec2 housePosition;
-
-  float frightenedUntil = 0.0f;
-
-  Ghost(std::string texturePath, glm::ivec2 scatterCorner, GhostType type)
-  {
-    texture = loadTexture(texturePath.c_str());
-    this->scatterCorner = scatterCorner;
-    this->type = type;
-    this->ghostSymbol = ghostTypeToSymbol[type];
-  }
-
-  void frighten(float duration)
-  {
-    mode = FRIGHTENED;
-    speed *= 0.5f;
-    frightenedUntil = duration;
-    printf("Ghost frightened until %.2f seconds\n", frightenedUntil);
-  }
-
-  void updateGhostMode(float timer)
-  {
-    if (mode == FRIGHTENED)
-      if (timer >= frightenedUntil)
-      {
-        printf("Ghost remains frightened at time %.2f seconds\n", timer);
-        speed *= 2.0f;
-      }
-      else
-      {
-        return;
-      }
-    if (mode == EATEN)
-    {
-      if (position != housePosition) {
-        return;
-      }
-    }
-    if (timer < 7)
-      mode = SCATTER;
-    else if (timer < 27)
-      mode = CHASE;
-    else if (timer < 34)
-      mode = SCATTER;
-    else if (timer < 54)
-      mode = CHASE;
-    else if (timer < 59)
-      mode = SCATTER;
-    else
-      mode = CHASE;
-  }
-
-};
-
-struct Pacman
-{
-  glm::vec2 position = glm::vec2(0.0f, 0.0f);
-  glm::vec2 direction = glm::vec2(0.0f, 0.0f);
-  glm::vec2 velocity = glm::vec2(0.0f, 0.0f);
-  float speed = 0.0f;
-  float animationTime = 0.0f;
-  unsigned int texture;
-  glm::ivec2 currentTile;
-
-  // textures for animation
-  std::vector<unsigned int> upTextures;
-  std::vector<unsigned int> downTextures;
-  std::vector<unsigned int> leftTextures;
-  std::vector<unsigned int> rightTextures;
-
-  Pacman()
-  {
-    upTextures.push_back(loadTexture("pacman-art/pacman-up/1.png"));
-    upTextures.push_back(loadTexture("pacman-art/pacman-up/2.png"));
-    upTextures.push_back(loadTexture("pacman-art/pacman-up/3.png"));
-    downTextures.push_back(loadTexture("pacman-art/pacman-down/1.png"));
-    downTextures.push_back(loadTexture("pacman-art/pacman-down/2.png"));
-    downTextures.push_back(loadTexture("pacman-art/pacman-down/3.png"));
-    leftTextures.push_back(loadTexture("pacman-art/pacman-left/1.png"));
-    leftTextures.push_back(loadTexture("pacman-art/pacman-left/2.png"));
-    leftTextures.push_back(loadTexture("pacman-art/pacman-left/3.png"));
-    rightTextures.push_back(loadTexture("pacman-art/pacman-right/1.png"));
-    rightTextures.push_back(loadTexture("pacman-art/pacman-right/2.png"));
-    rightTextures.push_back(loadTexture("pacman-art/pacman-right/3.png"));
-    texture = rightTextures[0];
-  }
-
-  void updateTexture(float deltaTime)
-  {
-    animationTime += deltaTime;
-    if (animationTime >= 0.1f)
-    { // change frame every 0.1 seconds
-      static int frame = 0;
-      frame = (frame + 1) % 3;
-      if (direction.x < 0)
-      {
-        texture = leftTextures[frame];
-      }
-      else if (direction.x > 0)
-      {
-        texture = rightTextures[frame];
-      }
-      else if (direction.y < 0)
-      {
-        texture = upTextures[frame];
-      }
-      else if (direction.y > 0)
-      {
-        texture = downTextures[frame];
-      }
-      animationTime = 0.0f;
-    }
-  }
-};
-
-struct Game
-{
-  float score = 0.0f;
-  float tileSize = 32.0f;
-  float startX = 200.0f;
-  float startY = 200.0f;
-  float gameTime = 0.0f;
-  Pacman pacman;
-  std::vector<std::string> map;
-  GAME_STATE state = GAME_MENU;
   unsigned int VAO;
-  Shader shaderProgram;
-
-  // textures
-  unsigned int wallTexture;
-  unsigned int pelletTexture;
-  unsigned int appleTexture;
-  unsigned int frigthenedTexture;
-
-  // ghosts
-  std::vector<Ghost> ghosts;
-
-  float frightenedUntil = 0.0f;
-  float globalModeTimer = 0.0f;
+  Shader spriteShader;
+  SpriteBatch spriteBatch;
+  UniformBuffer<FrameConstants> frameConstants;
+  // The board (walls, then pellets and fruit) sits at the front of the sprite
+  // batch and is uploaded once per Reset; eaten items are hidden by patching
+  // their one instance. Only pacman and the ghosts are re-uploaded each frame.
+  unsigned int drawnGeneration = 0;
+  int boardInstances = 0;
+  std::vector<int> itemInstances; // per cell, the instance drawing its item, -1 if none
+  BoardRenderMode boardMode;
+  unsigned int visibilityTexture = 0; // BOARD_VISIBILITY_TEXTURE: R8, one texel per cell
+
+  // every sprite is a layer of one array texture
+  TextureArray sprites;
+  SpriteLayers layers;
+
+  // baked assets from build/packer; anything missing from it loads from its own file
+  AssetPack assets;
 
   // sounds
   ma_engine soundEngine;
-  ma_sound chompSound;
+  bool soundEngineReady = false;
+  SoundBank sounds;
+  int chompSound = -1;
+  int fruitSound = -1;
 
-  Game();
+  Game(BoardRenderMode boardMode = BOARD_PATCHED_INSTANCES, uint64_t seed = 0);
   ~Game()
   {
-    ma_sound_uninit(&chompSound);
-    ma_engine_uninit(&soundEngine);
+    sounds.Shutdown();
+    if (soundEngineReady)
+      ma_engine_uninit(&soundEngine);
   }
-  void Reset();
-  void Draw(glm::mat4 projection);
+  void Draw(glm::mat4 projection, float alpha = 1.0f);
   void PhysicsUpdate(float deltaTime, glm::vec2 &desiredDir);
 
 private:
-  void updatePacmanPhysics(float deltaTime, glm::vec2 &desiredDir);
-  void updateGhostPhysics(Ghost &ghost, float deltaTime);
-  bool centerAligned(glm::vec2 tilePx, glm::vec2 position, glm::vec2 velocity);
-  glm::ivec2 pxToCell(glm::vec2 p);
-  glm::vec2 cellToPx(glm::ivec2 cell);
+  void playEventSounds();
+  void buildBoard();
+  void patchBoard();
 };
 
-glm::ivec2 Game::pxToCell(glm::vec2 p)
+Game::Game(BoardRenderMode boardMode, uint64_t seed) : Simulation(seed), boardMode(boardMode)
 {
-  float fx = (p.x - startX) / tileSize;
-  float fy = (p.y - startY) / tileSize;
-  return {(int)std::round(fx), (int)std::round(fy)};
-}
+  if (assets.Open("assets.pack"))
+    printf("Loading assets from assets.pack.\n");
+
+  layers.ghosts[BLINKY] = sprites.Add("pacman-art/ghosts/blinky.png");
+  layers.ghosts[PINKY] = sprites.Add("pacman-art/ghosts/pinky.png");
+  layers.ghosts[INKY] = sprites.Add("pacman-art/ghosts/inky.png");
+  layers.ghosts[CLYDE] = sprites.Add("pacman-art/ghosts/clyde.png");
+  layers.frightened = sprites.Add("pacman-art/ghosts/blue_ghost.png");
+
+  const char *pacmanFrameDirs[] = {"right", "left", "down", "up"};
+  for (int d = 0; d < 4; d++)
+  {
+    for (int f = 0; f < 3; f++)
+    {
+      std::string path = std::string("pacman-art/pacman-") + pacmanFrameDirs[d] + "/" + std::to_string(f + 1) + ".png";
+      layers.pacman[d][f] = sprites.Add(path);
+    }
+  }
+
+  layers.wall = sprites.Add("wall.png");
+  layers.pellet = sprites.Add("pacman-art/other/dot.png");
+  layers.apple = sprites.Add("pacman-art/other/apple.png");
+  layers.strawberry = sprites.Add("pacman-art/other/strawberry.png");
+
+  // decode the sprites in the background while sound, shaders and buffers are set up
+  ThreadPool loaders;
+  sprites.Decode(loaders, &assets);
 
-Game::Game()
-{
-  // Initialize default map
   ma_result result;
   result = ma_engine_init(NULL, &soundEngine);
   if (result != MA_SUCCESS)
@@ -234,30 +107,24 @@ Game::Game()
   else
   {
     printf("Sound engine initialized successfully.\n");
-    // Initialize the chomp sound
-    result = ma_sound_init_from_file(&soundEngine, "sounds/chomp.mp3", 0, NULL, NULL, &chompSound);
-    if (result != MA_SUCCESS)
-    {
-      printf("Failed to initialize chomp sound: %d\n", result);
-    }
+    soundEngineReady = true;
+    // one chomp at a time, a new one only once the last has finished;
+    // overlapping fruit pickups each get a voice
+    chompSound = sounds.Add(&soundEngine, "sounds/chomp.mp3", 1, false, &assets);
+    fruitSound = sounds.Add(&soundEngine, "sounds/pacman_eatfruit.wav", 4, true, &assets);
+    sounds.Start();
   }
 
-  ghosts.push_back(Ghost("pacman-art/ghosts/blinky.png", {26, 1}, BLINKY));
-  ghosts.push_back(Ghost("pacman-art/ghosts/pinky.png", {3, 1}, PINKY));
-  ghosts.push_back(Ghost("pacman-art/ghosts/inky.png", {1, 25}, INKY));
-  ghosts.push_back(Ghost("pacman-art/ghosts/clyde.png", {26, 25}, CLYDE));
-
-  shaderProgram = Shader("./shaders/shader.vs", "./shaders/shader.fs");
-  shaderProgram.use();
-  shaderProgram.setInt("texture1", 0);
-
-  glm::mat4 view = glm::mat4(1.0f);
-  glUniformMatrix4fv(glGetUniformLocation(shaderProgram.ID, "view"), 1, GL_FALSE, glm::value_ptr(view));
-
-  wallTexture = loadTexture("wall.png");
-  pelletTexture = loadTexture("pacman-art/other/dot.png");
-  appleTexture = loadTexture("pacman-art/other/apple.png");
-  frigthenedTexture = loadTexture("pacman-art/ghosts/blue_ghost.png");
+  const AssetPackEntry *vertexSource = assets.Find("shaders/sprite.vs", ASSET_SHADER);
+  const AssetPackEntry *fragmentSource = assets.Find("shaders/sprite.fs", ASSET_SHADER);
+  if (vertexSource && fragmentSource)
+    spriteShader = Shader::FromSource((const char *)assets.Data(*vertexSource), (const char *)assets.Data(*fragmentSource));
+  else
+    spriteShader = Shader("shaders/sprite.vs", "shaders/sprite.fs");
+  spriteShader.set(spriteShader.uniform<int>("sprites"), 0);
+  spriteShader.set(spriteShader.uniform<int>("itemVisibility"), 1);
+  spriteShader.bindUniformBlock("FrameConstants", FRAME_CONSTANTS_BINDING);
+  frameConstants.Init(FRAME_CONSTANTS_BINDING);
 
   // quad vertices
   float vertices[] = {
@@ -293,375 +160,121 @@ Game::Game()
   glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind VBO
   glBindVertexArray(0);             // unbind VAO
   this->VAO = VAO;
-  Reset();
-}
+  spriteBatch.Init(VAO);
 
-void Game::Reset()
-{
-  score = 0.0f;
-  pacman.position = glm::vec2(0.0f, 0.0f);
-  pacman.direction = glm::vec2(0.0f, 0.0f);
-  pacman.velocity = glm::vec2(0.0f, 0.0f);
-  pacman.speed = tileSize * 8; // pixels per second
-  for (auto &ghost : ghosts)
-  {
-    ghost.direction = glm::ivec2(0, -1);
-    ghost.velocity = glm::vec2(0.0f, 0.0f);
-    ghost.speed = tileSize * 8; // pixels per second
-    ghost.mode = SCATTER;
-  }
-  state = GAME_MENU;
-  gameTime = 0.0f;
-
-  map = {
-      "############################",
-      "#............##............#",
-      "#.####.#####.##.#####.####.#",
-      "#.####.#####.##.#####.####.#",
-      "#.####.#####.##.#####.####.#",
-      "#..........................#",
-      "#.####.##.########.##.####.#",
-      "#......##....##....##......#",
-      "######.##### ## #####.######",
-      "     #.##### ## #####.#     ",
-      "     #.##          ##.#     ",
-      "     #.## ###--### ##.#     ",
-      "######.## #      # ##.######",
-      "#     .   #      #   .     #",
-      "######.## # IBPC # ##.######",
-      "     #.## ######## ##.#     ",
-      "     #.##          ##.#     ",
-      "     #.## ######## ##.#     ",
-      "######.## ######## ##.######",
-      "#............##............#",
-      "#.####.#####.##.#####.####.#",
-      "#...##................##...#",
-      "###.##.##.########.##.##.###",
-      "#......##....##....##......#",
-      "#.##########.##.##########.#",
-      "#.*......................A.#",
-      "############################"};
-
-  for (unsigned int y = 0; y < map.size(); y++)
-  {
-    for (unsigned int x = 0; x < map[y].length(); x++)
-    {
-      if (x == 14 && y == 16)
-      {
-        pacman.position = glm::vec2(startX + (x * tileSize), startY + (y * tileSize));
-        pacman.currentTile = glm::ivec2(x, y);
-      }
-      if (map[y][x] == 'B' || map[y][x] == 'P' || map[y][x] == 'I' || map[y][x] == 'C')
-      {
-        for (auto &ghost : ghosts)
-        {
-          if (ghost.ghostSymbol == map[y][x])
-          {
-            ghost.position = glm::vec2(startX + (x * tileSize), startY + (y * tileSize));
-            ghost.housePosition = ghost.position;
-          }
-        }
-      }
-    }
-  }
+  loaders.Wait();
+  sprites.Upload();
 }
 
-void Game::Draw(glm::mat4 projection)
+// alpha is how far the renderer is between the last two simulation ticks
+void Game::Draw(glm::mat4 projection, float alpha)
 {
-  glBindVertexArray(this->VAO);
-  glUniformMatrix4fv(glGetUniformLocation(shaderProgram.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+  PROFILE_ZONE("Draw");
+  if (drawnGeneration != boardGeneration)
+    buildBoard();
+  else
+    patchBoard();
 
-  for (unsigned int y = 0; y < map.size(); y++)
-  {
-    for (unsigned int x = 0; x < map[y].length(); x++)
-    {
-      if (map[y][x] == '#' || map[y][x] == '.' || map[y][x] == 'A' || map[y][x] == '*')
-      {
-        float xPos = startX + (x * tileSize);
-        float yPos = startY + (y * tileSize);
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(xPos, yPos, 0.0f));
-        model = glm::scale(model, glm::vec3(tileSize, tileSize, 1.0f));
-        unsigned int textureID = (map[y][x] == '.') ? pelletTexture : wallTexture;
-        if (map[y][x] == 'A')
-          textureID = appleTexture;
-        // big pellet
-        if (map[y][x] == '*')
-        {
-          model = glm::scale(model, glm::vec3(3.0f, 3.0f, 1.0f));
-          textureID = pelletTexture;
-        }
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-      }
-    }
-  }
+  AddActorSprites(spriteBatch, *this, layers, alpha);
+  spriteBatch.Upload(boardInstances);
 
-  // draw pacman
-  glm::mat4 model = glm::mat4(1.0f);
-  model = glm::translate(model, glm::vec3(pacman.position, 0.0f));
-  model = glm::scale(model, glm::vec3(tileSize, tileSize, 1.0f));
+  // one texture bind and one instanced draw for the whole frame
+  frameConstants.Update({projection, glm::mat4(1.0f)});
+  spriteShader.use();
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, pacman.texture);
-  glUniformMatrix4fv(glGetUniformLocation(shaderProgram.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-  // draw red ghost
-  for (auto &ghost : ghosts)
+  glBindTexture(GL_TEXTURE_2D_ARRAY, sprites.ID);
+  if (boardMode == BOARD_VISIBILITY_TEXTURE)
   {
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(ghost.position, 0.0f));
-    model = glm::scale(model, glm::vec3(tileSize, tileSize, 1.0f));
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, visibilityTexture);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, ghost.mode == FRIGHTENED ? frigthenedTexture : ghost.texture);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
   }
-
+  glBindVertexArray(this->VAO);
+  spriteBatch.Draw(0, (int)spriteBatch.instances.size());
   glBindVertexArray(0);
 }
 
-bool moveableTile(char tile)
-{
-  return tile != '#' && tile != '-';
-}
-
-bool canGhostMove(char tile)
-{
-  return tile != '#';
-}
-
-glm::vec2 Game::cellToPx(glm::ivec2 cell)
-{
-  float px = startX + cell.x * tileSize;
-  float py = startY + cell.y * tileSize;
-  return glm::vec2(px, py);
-}
-
-bool Game::centerAligned(glm::vec2 tilePx, glm::vec2 position, glm::vec2 velocity)
+// lays out every wall and item of a freshly loaded board and uploads them
+void Game::buildBoard()
 {
-  float epsilon = velocity == glm::vec2(0.0f, 0.0f) ? 0.1f : glm::length(velocity) * 0.5f;
-  return fabs(tilePx.x - position.x) < epsilon && fabs(tilePx.y - position.y) < epsilon;
-}
-
-void Game::updatePacmanPhysics(float deltaTime, glm::vec2 &desiredDir)
-{
-  pacman.currentTile = pxToCell(pacman.position);
-  glm::vec2 pacmanTilePx = cellToPx(pacman.currentTile);
-  bool isPacmanCenterAligned = centerAligned(pacmanTilePx, pacman.position, pacman.velocity);
-  char *currentTileChar = &map[pacman.currentTile.y][pacman.currentTile.x];
-
-  if (isPacmanCenterAligned)
+  spriteBatch.Begin();
+  AddBoardSprites(spriteBatch, *this, layers, itemInstances);
+  boardInstances = (int)spriteBatch.instances.size();
+  spriteBatch.Upload();
+  changedTiles.clear();
+  drawnGeneration = boardGeneration;
+
+  if (boardMode != BOARD_VISIBILITY_TEXTURE)
   {
-    pacman.position = pacmanTilePx; // Snap to center
-
-    if (*currentTileChar == '.')
-    {
-      // Check if the chomp sound is not currently playing, or restart if it's already playing
-      if (!ma_sound_is_playing(&chompSound))
-      {
-        printf("Playing chomp sound.\n");
-        ma_sound_seek_to_pcm_frame(&chompSound, 0); // Reset to beginning
-        ma_sound_start(&chompSound);                // Start playing
-      }
-      *currentTileChar = ' ';
-      score += 10.0f;
-      printf("Pellet eaten! Score: %.1f\n", score);
-    }
-    else if (*currentTileChar == 'A')
-    {
-      *currentTileChar = ' ';
-      score += 100.0f;
-      printf("Apple eaten! Score: %.1f\n", score);
-      ma_engine_play_sound(&soundEngine, "sounds/pacman_eatfruit.wav", NULL);
-    }
-    else if (*currentTileChar == '*')
-    {
-      *currentTileChar = ' ';
-      score += 50.0f;
-      printf("Big pellet eaten! Score: %.1f\n", score);
-      for (auto &ghost : ghosts)
-      {
-        ghost.frighten(gameTime + 7.0f); // frightened for 10 seconds
-      }
-    }
-
-    if ((desiredDir.x != 0 || desiredDir.y != 0))
-    {
-      auto nextTile = pxToCell(pacman.position) + (glm::ivec2)desiredDir;
-      if (moveableTile(map[nextTile.y][nextTile.x]))
-      {
-        pacman.direction = desiredDir;
-        desiredDir = glm::vec2(0, 0);
-      }
-    }
-  }
-
-  pacman.velocity = pacman.direction * deltaTime * pacman.speed;
-  glm::ivec2 nextTile = pxToCell(pacman.position + pacman.velocity) + (glm::ivec2)pacman.direction;
-  if (!isPacmanCenterAligned || moveableTile(map[nextTile.y][nextTile.x]))
-  {
-    pacman.position += pacman.velocity;
-  }
-  else
-  {
-    pacman.direction = glm::vec2(0, 0);
+    spriteShader.set(spriteShader.uniform<int>("itemEnd"), 0);
+    return;
   }
+  std::vector<uint8_t> visibility(tiles.cellCount());
+  for (int i = 0; i < tiles.cellCount(); i++)
+    visibility[i] = itemInstances[i] >= 0 ? 255 : 0;
+  if (!visibilityTexture)
+    glGenTextures(1, &visibilityTexture);
+  glBindTexture(GL_TEXTURE_2D, visibilityTexture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, tiles.width, tiles.height, 0, GL_RED, GL_UNSIGNED_BYTE, visibility.data());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  // the items follow the walls, so they are everything after the first of them
+  int itemFirst = boardInstances;
+  for (int instance : itemInstances)
+    if (instance >= 0)
+      itemFirst = std::min(itemFirst, instance);
+  spriteShader.set(spriteShader.uniform<int>("itemFirst"), itemFirst);
+  spriteShader.set(spriteShader.uniform<int>("itemEnd"), boardInstances);
+  spriteShader.set(spriteShader.uniform<glm::vec2>("boardOrigin"), cellToPx(glm::ivec2(0, 0)));
+  spriteShader.set(spriteShader.uniform<float>("boardTileSize"), (float)tileSize);
 }
 
-void Game::updateGhostPhysics(Ghost &ghost, float deltaTime)
+// hides the items eaten since the last frame, one instance or texel upload each
+void Game::patchBoard()
 {
-  auto ghostCurrenTile = pxToCell(ghost.position);
-  auto ghostTilePx = cellToPx(ghostCurrenTile);
-  bool isGhostCenterAligned = centerAligned(ghostTilePx, ghost.position, ghost.velocity);
-  glm::ivec2 targetTile;
-  if (ghost.type == BLINKY)
-    targetTile = pacman.currentTile;
-  if (ghost.type == PINKY)
-    targetTile = pacman.currentTile + glm::ivec2(4 * (int)pacman.direction.x, 4 * (int)pacman.direction.y);
-  if (ghost.type == INKY)
+  static const uint8_t hidden = 0;
+  if (boardMode == BOARD_VISIBILITY_TEXTURE && !changedTiles.empty())
   {
-    glm::ivec2 blinkyTile;
-    for (auto &g : ghosts)
-    {
-      if (g.type == BLINKY)
-      {
-        blinkyTile = pxToCell(g.position);
-        break;
-      }
-    }
-    glm::ivec2 vector = pacman.currentTile + glm::ivec2(2 * (int)pacman.direction.x, 2 * (int)pacman.direction.y) - blinkyTile;
-    targetTile = blinkyTile + vector;
+    glBindTexture(GL_TEXTURE_2D, visibilityTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   }
-  if (ghost.type == CLYDE)
+  for (int i : changedTiles)
   {
-    float distance = glm::length(glm::vec2(ghostCurrenTile - pacman.currentTile));
-    if (distance > 8.0f)
-      targetTile = pacman.currentTile;
-    else
-      targetTile = ghost.scatterCorner;
-  }
-  
-  if (ghost.mode == SCATTER)
-    targetTile = ghost.scatterCorner;
-
-  if (ghost.mode == EATEN)
-    targetTile = pxToCell(ghost.housePosition);
-
-  if (isGhostCenterAligned)
-  {
-    static const glm::ivec2 dirs[] = {
-        {1, 0}, {-1, 0}, {0, 1}, {0, -1}};
-    // printf("Red ghost at tile (%d, %d)\n", ghostCurrenTile.x, ghostCurrenTile.y);
-    ghost.position = ghostTilePx; // Snap to center
-    if (ghost.mode == FRIGHTENED)
+    int instance = itemInstances[i];
+    if (instance < 0 || (tiles.cells[i] & (TILE_PELLET | TILE_POWER_PELLET | TILE_FRUIT)))
+      continue;
+    if (boardMode == BOARD_VISIBILITY_TEXTURE)
     {
-      std::vector<glm::ivec2> possibleDirs;
-      for (auto d : dirs)
-      {
-        glm::ivec2 next = ghostCurrenTile + d;
-        if (canGhostMove(map[next.y][next.x]) && glm::vec2(d) != -ghost.direction)
-        {
-          possibleDirs.push_back(d);
-        }
-      }
-      if (!possibleDirs.empty())
-      {
-        int r = rand() % possibleDirs.size();
-        ghost.direction = glm::vec2(possibleDirs[r]);
-      }
-      else
-      {
-        ghost.direction = -ghost.direction; // reverse
-      }
-      ghost.velocity = ghost.direction * deltaTime * ghost.speed;
-      ghost.position += ghost.velocity;
-      // printf("Frightened ghost chooses direction (%.1f, %.1f)\n", ghost.direction.x, ghost.direction.y);
-      return;
+      glTexSubImage2D(GL_TEXTURE_2D, 0, i % tiles.width, i / tiles.width, 1, 1, GL_RED, GL_UNSIGNED_BYTE, &hidden);
     }
-
-    auto cmpVec2 = [](const glm::ivec2 &a, const glm::ivec2 &b)
-    {
-      return (a.y < b.y) || (a.y == b.y && a.x < b.x);
-    };
-    std::queue<glm::ivec2> q;
-    std::map<glm::ivec2, glm::ivec2, decltype(cmpVec2)> cameFrom(cmpVec2);
-    q.push(ghostCurrenTile);
-    cameFrom[ghostCurrenTile] = ghostCurrenTile;
-
-    while (!q.empty())
-    {
-      glm::ivec2 cur = q.front();
-      q.pop();
-      if (cur == targetTile)
-        break;
-
-      for (auto d : dirs)
-      {
-        glm::ivec2 next = cur + d;
-        if (!canGhostMove(map[next.y][next.x]))
-          continue;
-        if (cameFrom.find(next) != cameFrom.end())
-          continue; // already visited
-        // printf("Red ghost exploring tile (%d, %d) char=%c\n", next.x, next.y, map[next.y][next.x]);
-        cameFrom[next] = cur;
-        q.push(next);
-      }
-    }
-
-    if (cameFrom.find(targetTile) == cameFrom.end())
+    else
     {
-      // printf("Ghost could not find path to target tile: (%d, %d)\n", targetTile.x, targetTile.y);
-      ghost.direction = glm::vec2(0, 0);
-      return; // no path found
+      // a zero-size quad covers no pixels
+      spriteBatch.instances[instance].scale = 0.0f;
+      spriteBatch.Patch(instance);
     }
-
-    // backtrack one step from goal to find direction
-    glm::ivec2 step = targetTile;
-    while (cameFrom.count(step) && cameFrom[step] != ghostCurrenTile)
-      step = cameFrom[step];
-
-    ghost.direction = glm::sign(glm::vec2(step - ghostCurrenTile));
-    // printf("Red ghost chooses direction (%.1f, %.1f)\n", redGhost.direction.x, redGhost.direction.y);
+    itemInstances[i] = -1;
   }
-
-  ghost.velocity = ghost.direction * deltaTime * ghost.speed;
-  ghost.position += ghost.velocity;
+  if (boardMode == BOARD_VISIBILITY_TEXTURE && !changedTiles.empty())
+    glBindTexture(GL_TEXTURE_2D, 0);
+  changedTiles.clear();
+  spriteBatch.instances.resize(boardInstances);
 }
 
 void Game::PhysicsUpdate(float deltaTime, glm::vec2 &desiredDir)
 {
-  gameTime += deltaTime;
-  globalModeTimer += deltaTime;
-  auto pacmanTile = pxToCell(pacman.position);
-  for (auto &ghost : ghosts)
-  {
-    ghost.updateGhostMode(globalModeTimer);
-    auto ghostTile = pxToCell(ghost.position);
-    if (pacmanTile == ghostTile && ghost.mode != EATEN)
-    {
-      if (ghost.mode == FRIGHTENED)
-      {
-        printf("Pacman ate a ghost!\n");
-        ghost.targetTile = ghost.housePosition;
-        ghost.mode = EATEN;
-      }
-      else {
-        printf("Ghost %c caught Pacman! Game Over!\n", ghost.ghostSymbol);
-        Reset();
-      }
-    }
-  }
+  Simulation::PhysicsUpdate(deltaTime, desiredDir);
+  playEventSounds();
+}
 
-  updatePacmanPhysics(deltaTime, desiredDir);
-  for (auto &ghost : ghosts)
-  {
-    updateGhostPhysics(ghost, deltaTime);
-  }
+void Game::playEventSounds()
+{
+  if (events & EVENT_PELLET_EATEN)
+    sounds.Play(chompSound);
+  if (events & EVENT_FRUIT_EATEN)
+    sounds.Play(fruitSound);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,359 @@
+#ifndef GHOST_ARRAYS_H
+#define GHOST_ARRAYS_H
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+#include "logger.h"
+
+// The movement kernels use SSE2 where the target has it (every x86-64) and
+// plain loops elsewhere; build with -DPACMAN_SIMD=0 to force the loops. Both
+// give bit-identical results, so runs replay the same either way.
+#ifndef PACMAN_SIMD
+#if defined(__SSE2__)
+#define PACMAN_SIMD 1
+#else
+#define PACMAN_SIMD 0
+#endif
+#endif
+#if PACMAN_SIMD
+#include <emmintrin.h>
+#endif
+
+enum GhostMode
+{
+  SCATTER,
+  CHASE,
+  FRIGHTENED,
+  EATEN
+};
+enum GhostType
+{
+  BLINKY,
+  PINKY,
+  INKY,
+  CLYDE
+};
+
+// ghost type to symbol mapping, indexed by GhostType; read-only, so any
+// thread may spawn ghosts
+constexpr char ghostTypeToSymbol[] = {'B', 'P', 'I', 'C'};
+
+// the type a map spawn marker stands for; false if c isn't one
+bool ghostTypeForSymbol(char c, GhostType &type)
+{
+  switch (c)
+  {
+  case 'B':
+    type = BLINKY;
+    return true;
+  case 'P':
+    type = PINKY;
+    return true;
+  case 'I':
+    type = INKY;
+    return true;
+  case 'C':
+    type = CLYDE;
+    return true;
+  }
+  return false;
+}
+
+// One entry of a ghost roster. A game spawns one ghost per entry, in order,
+// at a map marker of its type: the k-th ghost of a type takes that type's
+// k-th marker, wrapping around when there are more ghosts than markers.
+struct GhostSpawn
+{
+  GhostType type;
+  glm::ivec2 scatterCorner;
+};
+
+// the arcade four, one per type, with their corners of the default maze
+const GhostSpawn classicGhosts[] = {
+    {BLINKY, {26, 1}},
+    {PINKY, {3, 1}},
+    {INKY, {1, 25}},
+    {CLYDE, {26, 25}}};
+
+// count ghosts cycling through the classic four, for crowded stress boards
+std::vector<GhostSpawn> ghostRoster(size_t count)
+{
+  std::vector<GhostSpawn> roster(count);
+  for (size_t i = 0; i < count; i++)
+    roster[i] = classicGhosts[i % 4];
+  return roster;
+}
+
+// One ghost as a plain record: how ghosts are added, and how snapshots
+// store them. Live ghosts are kept in GhostArrays.
+struct Ghost
+{
+  glm::vec2 position = glm::vec2(0.0f, 0.0f);
+  glm::vec2 previousPosition = glm::vec2(0.0f, 0.0f); // position at the start of the last tick, for render interpolation
+  glm::vec2 direction = glm::vec2(0.0f, 0.0f);
+  glm::vec2 velocity = glm::vec2(0.0f, 0.0f);
+  float speed = 0.0f;
+  GhostMode mode = SCATTER;
+  glm::vec2 targetTile = glm::vec2(0.0f, 0.0f);
+  glm::ivec2 scatterCorner = glm::ivec2(0, 0);
+  GhostType type = BLINKY;
+  char ghostSymbol = 'B';
+
+  glm::vec2 housePosition = glm::vec2(0.0f, 0.0f);
+
+  float frightenedUntil = 0.0f;
+
+  Ghost() {}
+  Ghost(glm::ivec2 scatterCorner, GhostType type)
+  {
+    this->scatterCorner = scatterCorner;
+    this->type = type;
+    this->ghostSymbol = ghostTypeToSymbol[type];
+  }
+};
+
+// Live ghost state as structure-of-arrays, ghost i at index i of each. What
+// every ghost touches every tick sits in its own contiguous array, so the
+// kernels below stream through only those, and a stress board of thousands
+// of ghosts doesn't drag identity and spawn data through the cache.
+struct GhostArrays
+{
+  // hot: read or written by every ghost every tick
+  std::vector<glm::vec2> position;
+  std::vector<glm::vec2> previousPosition; // for render interpolation
+  std::vector<glm::vec2> direction;
+  std::vector<glm::vec2> velocity;
+  std::vector<float> speed;
+  std::vector<uint8_t> mode;    // GhostMode
+  std::vector<glm::ivec2> cell; // pxToCell(position), as of the last LocateGhosts
+  std::vector<uint8_t> aligned; // at the center of cell, as of the last LocateGhosts
+
+  // cold: read when a ghost reaches a cell center or changes mode
+  std::vector<uint8_t> type; // GhostType
+  std::vector<float> frightenedUntil;
+  std::vector<glm::ivec2> scatterCorner;
+  std::vector<glm::vec2> housePosition;
+  std::vector<glm::vec2> targetTile;
+  std::vector<char> symbol;
+  // the ghost whose cell this one's targeting reads (an INKY's BLINKY), -1
+  // for none; set by Link
+  std::vector<int32_t> leader;
+  std::vector<int32_t> blinkies; // Link's scratch, kept so restores don't allocate
+
+  size_t size() const { return position.size(); }
+  void Add(const Ghost &ghost);
+  Ghost Get(size_t i) const;
+  // keeps the capacity, so refilling to the same count doesn't allocate
+  void Clear();
+  // pairs the k-th INKY with the k-th BLINKY, wrapping around when there are
+  // fewer BLINKYs; call after the last Add
+  void Link();
+
+  void Frighten(size_t i, float until);
+  void UpdateMode(size_t i, float timer);
+};
+
+void GhostArrays::Add(const Ghost &ghost)
+{
+  position.push_back(ghost.position);
+  previousPosition.push_back(ghost.previousPosition);
+  direction.push_back(ghost.direction);
+  velocity.push_back(ghost.velocity);
+  speed.push_back(ghost.speed);
+  mode.push_back((uint8_t)ghost.mode);
+  cell.push_back(glm::ivec2(0, 0));
+  aligned.push_back(0);
+  type.push_back((uint8_t)ghost.type);
+  frightenedUntil.push_back(ghost.frightenedUntil);
+  scatterCorner.push_back(ghost.scatterCorner);
+  housePosition.push_back(ghost.housePosition);
+  targetTile.push_back(ghost.targetTile);
+  symbol.push_back(ghost.ghostSymbol);
+  leader.push_back(-1);
+}
+
+Ghost GhostArrays::Get(size_t i) const
+{
+  Ghost ghost(scatterCorner[i], (GhostType)type[i]);
+  ghost.position = position[i];
+  ghost.previousPosition = previousPosition[i];
+  ghost.direction = direction[i];
+  ghost.velocity = velocity[i];
+  ghost.speed = speed[i];
+  ghost.mode = (GhostMode)mode[i];
+  ghost.targetTile = targetTile[i];
+  ghost.ghostSymbol = symbol[i];
+  ghost.housePosition = housePosition[i];
+  ghost.frightenedUntil = frightenedUntil[i];
+  return ghost;
+}
+
+void GhostArrays::Clear()
+{
+  position.clear();
+  previousPosition.clear();
+  direction.clear();
+  velocity.clear();
+  speed.clear();
+  mode.clear();
+  cell.clear();
+  aligned.clear();
+  type.clear();
+  frightenedUntil.clear();
+  scatterCorner.clear();
+  housePosition.clear();
+  targetTile.clear();
+  symbol.clear();
+  leader.clear();
+}
+
+void GhostArrays::Link()
+{
+  blinkies.clear();
+  for (size_t i = 0; i < size(); i++)
+    if (type[i] == BLINKY)
+      blinkies.push_back((int32_t)i);
+  size_t inkies = 0;
+  for (size_t i = 0; i < size(); i++)
+    leader[i] = type[i] == INKY && !blinkies.empty() ? blinkies[inkies++ % blinkies.size()] : -1;
+}
+
+void GhostArrays::Frighten(size_t i, float until)
+{
+  mode[i] = FRIGHTENED;
+  speed[i] *= 0.5f;
+  frightenedUntil[i] = until;
+  LOG_DEBUG("Ghost frightened until %.2f seconds", until);
+}
+
+void GhostArrays::UpdateMode(size_t i, float timer)
+{
+  if (mode[i] == FRIGHTENED)
+  {
+    if (timer >= frightenedUntil[i])
+    {
+      LOG_DEBUG("Ghost remains frightened at time %.2f seconds", timer);
+      speed[i] *= 2.0f;
+    }
+    else
+    {
+      return;
+    }
+  }
+  if (mode[i] == EATEN)
+  {
+    if (position[i] != housePosition[i])
+    {
+      return;
+    }
+  }
+  if (timer < 7)
+    mode[i] = SCATTER;
+  else if (timer < 27)
+    mode[i] = CHASE;
+  else if (timer < 34)
+    mode[i] = SCATTER;
+  else if (timer < 54)
+    mode[i] = CHASE;
+  else if (timer < 59)
+    mode[i] = SCATTER;
+  else
+    mode[i] = CHASE;
+}
+
+// Scalar kernels: the reference the SIMD ones match, and their tails.
+
+// cell is position in cells from origin rounded as std::round does; aligned
+// is position within half a step (0.1 px at rest) of that cell's center
+void locateGhostsScalar(GhostArrays &ghosts, size_t first, size_t last, glm::vec2 origin, float tileSize)
+{
+  for (size_t i = first; i < last; i++)
+  {
+    glm::vec2 p = ghosts.position[i];
+    glm::ivec2 cell((int)std::round((p.x - origin.x) / tileSize), (int)std::round((p.y - origin.y) / tileSize));
+    glm::vec2 center(origin.x + cell.x * tileSize, origin.y + cell.y * tileSize);
+    glm::vec2 v = ghosts.velocity[i];
+    float epsilon = v == glm::vec2(0.0f, 0.0f) ? 0.1f : glm::length(v) * 0.5f;
+    ghosts.cell[i] = cell;
+    ghosts.aligned[i] = fabs(center.x - p.x) < epsilon && fabs(center.y - p.y) < epsilon;
+  }
+}
+
+// velocity = direction * deltaTime * speed, then position += velocity
+void integrateGhostsScalar(GhostArrays &ghosts, size_t first, size_t last, float deltaTime)
+{
+  for (size_t i = first; i < last; i++)
+  {
+    ghosts.velocity[i] = ghosts.direction[i] * deltaTime * ghosts.speed[i];
+    ghosts.position[i] += ghosts.velocity[i];
+  }
+}
+
+// Refreshes cell and aligned for ghosts [first, last). Two ghosts per SSE2
+// register: the vec2 arrays load as x0 y0 x1 y1.
+void LocateGhosts(GhostArrays &ghosts, size_t first, size_t last, glm::vec2 origin, float tileSize)
+{
+  size_t i = first;
+#if PACMAN_SIMD
+  const __m128 start = _mm_setr_ps(origin.x, origin.y, origin.x, origin.y);
+  const __m128 size = _mm_set1_ps(tileSize);
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 minusHalf = _mm_set1_ps(-0.5f);
+  const __m128 resting = _mm_set1_ps(0.1f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  for (; i + 2 <= last; i += 2)
+  {
+    __m128 position = _mm_loadu_ps((const float *)(ghosts.position.data() + i));
+    __m128 velocity = _mm_loadu_ps((const float *)(ghosts.velocity.data() + i));
+
+    // truncate, then step away from zero where the dropped fraction is a half or more
+    __m128 f = _mm_div_ps(_mm_sub_ps(position, start), size);
+    __m128i truncated = _mm_cvttps_epi32(f);
+    __m128 fraction = _mm_sub_ps(f, _mm_cvtepi32_ps(truncated));
+    __m128i up = _mm_castps_si128(_mm_cmpge_ps(fraction, half));        // -1 where rounding up
+    __m128i down = _mm_castps_si128(_mm_cmple_ps(fraction, minusHalf)); // -1 where rounding down
+    __m128i cell = _mm_add_epi32(_mm_sub_epi32(truncated, up), down);
+    _mm_storeu_si128((__m128i *)(ghosts.cell.data() + i), cell);
+
+    // each lane pair holds |v|^2 in both lanes after adding its swapped self
+    __m128 squared = _mm_mul_ps(velocity, velocity);
+    __m128 lengthSquared = _mm_add_ps(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 3, 0, 1)));
+    __m128 epsilon = _mm_mul_ps(_mm_sqrt_ps(lengthSquared), half);
+    __m128 still = _mm_cmpeq_ps(velocity, zero);
+    still = _mm_and_ps(still, _mm_shuffle_ps(still, still, _MM_SHUFFLE(2, 3, 0, 1)));
+    epsilon = _mm_or_ps(_mm_and_ps(still, resting), _mm_andnot_ps(still, epsilon));
+
+    __m128 center = _mm_add_ps(start, _mm_mul_ps(_mm_cvtepi32_ps(cell), size));
+    __m128 distance = _mm_andnot_ps(sign, _mm_sub_ps(center, position));
+    int inside = _mm_movemask_ps(_mm_cmplt_ps(distance, epsilon));
+    ghosts.aligned[i] = (inside & 3) == 3;
+    ghosts.aligned[i + 1] = (inside & 12) == 12;
+  }
+#endif
+  locateGhostsScalar(ghosts, i, last, origin, tileSize);
+}
+
+// Moves ghosts [first, last) one tick along their directions.
+void IntegrateGhosts(GhostArrays &ghosts, size_t first, size_t last, float deltaTime)
+{
+  size_t i = first;
+#if PACMAN_SIMD
+  const __m128 dt = _mm_set1_ps(deltaTime);
+  for (; i + 2 <= last; i += 2)
+  {
+    __m128 speed = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(ghosts.speed.data() + i));
+    speed = _mm_unpacklo_ps(speed, speed); // s0 s0 s1 s1
+    __m128 direction = _mm_loadu_ps((const float *)(ghosts.direction.data() + i));
+    __m128 velocity = _mm_mul_ps(_mm_mul_ps(direction, dt), speed);
+    __m128 position = _mm_loadu_ps((const float *)(ghosts.position.data() + i));
+    _mm_storeu_ps((float *)(ghosts.velocity.data() + i), velocity);
+    _mm_storeu_ps((float *)(ghosts.position.data() + i), _mm_add_ps(position, velocity));
+  }
+#endif
+  integrateGhostsScalar(ghosts, i, last, deltaTime);
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef INPUT_JOURNAL_H
+#define INPUT_JOURNAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+// A recorded session: the steering requests fed to PhysicsUpdate, one event
+// per tick on which the request changed, plus what the run ended with. With
+// the same seed and tick rate a Simulation replays it bit for bit.
+//   InputJournalHeader, then InputEvent[eventCount]
+static const char INPUT_JOURNAL_MAGIC[4] = {'P', 'M', 'I', 'J'};
+static const uint32_t INPUT_JOURNAL_VERSION = 1;
+
+struct InputJournalHeader
+{
+  char magic[4];
+  uint32_t version;
+  float tickRate;
+  uint32_t eventCount;
+  uint64_t seed;
+  uint32_t ticks; // ticks simulated in the whole session
+  float finalScore;
+  uint64_t finalHash; // Simulation::StateHash after the last tick
+};
+
+struct InputEvent
+{
+  uint32_t tick;
+  int8_t dx, dy; // desiredDir from this tick on
+  uint16_t reserved;
+};
+
+// Appends events while a session runs and fills in the header on Close.
+struct InputRecorder
+{
+  FILE *file = nullptr;
+  InputJournalHeader header;
+  glm::vec2 carried = glm::vec2(0.0f, 0.0f); // desiredDir as the last tick left it
+
+  ~InputRecorder()
+  {
+    if (file)
+      fclose(file);
+  }
+
+  bool Open(const char *path, float tickRate, uint64_t seed)
+  {
+    file = fopen(path, "wb");
+    if (!file)
+    {
+      printf("Failed to open input journal: %s\n", path);
+      return false;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INPUT_JOURNAL_MAGIC, 4);
+    header.version = INPUT_JOURNAL_VERSION;
+    header.tickRate = tickRate;
+    header.seed = seed;
+    fwrite(&header, sizeof(header), 1, file);
+    return true;
+  }
+
+  // call just before PhysicsUpdate for tick with the desiredDir it will get
+  void Record(uint32_t tick, glm::vec2 desiredDir)
+  {
+    if (!file || desiredDir == carried)
+      return;
+    InputEvent event = {tick, (int8_t)desiredDir.x, (int8_t)desiredDir.y, 0};
+    fwrite(&event, sizeof(event), 1, file);
+    header.eventCount++;
+    carried = desiredDir;
+  }
+
+  // call just after PhysicsUpdate, which may have consumed the request
+  void Settle(glm::vec2 desiredDir) { carried = desiredDir; }
+
+  void Close(uint32_t ticks, float finalScore, uint64_t finalHash)
+  {
+    if (!file)
+      return;
+    header.ticks = ticks;
+    header.finalScore = finalScore;
+    header.finalHash = finalHash;
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+    file = nullptr;
+  }
+};
+
+struct InputJournal
+{
+  InputJournalHeader header;
+  std::vector<InputEvent> events;
+
+  bool Load(const char *path)
+  {
+    FILE *file = fopen(path, "rb");
+    if (!file)
+      return false;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, INPUT_JOURNAL_MAGIC, 4) == 0 && header.version == INPUT_JOURNAL_VERSION;
+    if (ok)
+    {
+      events.resize(header.eventCount);
+      ok = fread(events.data(), sizeof(InputEvent), events.size(), file) == events.size();
+    }
+    fclose(file);
+    return ok;
+  }
+};
+
+#endif
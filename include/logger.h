@@ -0,0 +1,362 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+// Asynchronous logger. LOG_INFO("fmt", args...) copies the format pointer and
+// the raw arguments into a lock-free ring owned by the calling thread; a
+// background thread formats them printf-style and writes them to stdout, so
+// the caller never touches the stream. Levels below PACMAN_LOG_LEVEL are
+// compiled out, arguments and all. The default keeps the per-pellet and
+// per-ghost chatter out; build with -DPACMAN_LOG_LEVEL=0 to see it.
+// macros rather than an enum so #if can compare them
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF 4
+
+#ifndef PACMAN_LOG_LEVEL
+#define PACMAN_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// the format must be a string with static storage, e.g. a literal; arguments
+// may be numbers, chars, pointers or C strings (copied, up to the record's
+// text space)
+#if PACMAN_LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Logger::Write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+#if PACMAN_LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) Logger::Write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if PACMAN_LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) Logger::Write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+#if PACMAN_LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Logger::Write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+enum LogArgType : uint8_t
+{
+  LOG_ARG_INT,
+  LOG_ARG_UINT,
+  LOG_ARG_DOUBLE,
+  LOG_ARG_POINTER,
+  LOG_ARG_STRING // value is an offset into the record's text
+};
+
+union LogArg
+{
+  long long i;
+  unsigned long long u;
+  double f;
+  const void *p;
+};
+
+// one unformatted message, 128 bytes
+struct LogRecord
+{
+  static constexpr int MAX_ARGS = 6;
+  static constexpr int TEXT_SIZE = 48;
+
+  const char *format;
+  uint64_t time; // steady_clock nanoseconds
+  uint8_t level;
+  uint8_t argCount;
+  uint8_t textUsed;
+  LogArgType types[MAX_ARGS];
+  LogArg args[MAX_ARGS];
+  char text[TEXT_SIZE]; // copies of the string arguments
+
+  template <typename T>
+  void capture(T value)
+  {
+    LogArg &arg = args[argCount];
+    LogArgType &type = types[argCount++];
+    if constexpr (std::is_floating_point<T>::value)
+    {
+      type = LOG_ARG_DOUBLE;
+      arg.f = value;
+    }
+    else if constexpr (std::is_integral<T>::value || std::is_enum<T>::value)
+    {
+      type = std::is_signed<T>::value ? LOG_ARG_INT : LOG_ARG_UINT;
+      if (type == LOG_ARG_INT)
+        arg.i = (long long)value;
+      else
+        arg.u = (unsigned long long)value;
+    }
+    else if constexpr (std::is_convertible<T, const char *>::value)
+    {
+      // truncated to the space left; the last byte always stays a NUL
+      const char *s = value ? (const char *)value : "(null)";
+      size_t room = TEXT_SIZE - 1 - textUsed;
+      size_t n = std::min(strlen(s), room);
+      type = LOG_ARG_STRING;
+      arg.u = n ? textUsed : TEXT_SIZE - 1;
+      memcpy(text + textUsed, s, n);
+      text[textUsed + n] = 0;
+      textUsed = (uint8_t)std::min<size_t>(textUsed + n + 1, TEXT_SIZE - 1);
+    }
+    else
+    {
+      static_assert(std::is_pointer<T>::value, "log arguments must be numbers, pointers or C strings");
+      type = LOG_ARG_POINTER;
+      arg.p = (const void *)value;
+    }
+  }
+};
+static_assert(sizeof(LogRecord) == 128, "keep records two cache lines");
+
+// single producer (the owning thread), single consumer (the flusher)
+struct LogRing
+{
+  static constexpr uint32_t CAPACITY = 1 << 12;
+
+  LogRecord records[CAPACITY];
+  std::atomic<uint32_t> head{0}; // next write, owned by the producer
+  std::atomic<uint32_t> tail{0}; // next read, owned by the consumer
+  std::atomic<uint64_t> dropped{0};
+
+  // the slot to fill, or null when full; publish it with commit
+  LogRecord *reserve()
+  {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == CAPACITY)
+    {
+      // full: drop rather than block the hot path
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &records[h % CAPACITY];
+  }
+
+  void commit()
+  {
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  template <typename Fn>
+  void drain(Fn fn)
+  {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    for (; t != h; t++)
+      fn(records[t % CAPACITY]);
+    tail.store(t, std::memory_order_release);
+  }
+};
+
+struct Logger
+{
+  std::mutex mutex; // guards rings and serializes flushes
+  std::vector<LogRing *> rings;
+  std::atomic<bool> stopping{false};
+  std::thread flusher;
+  FILE *out = stdout;
+  uint64_t epoch = now();
+
+  static Logger &Get()
+  {
+    static Logger *logger = start(); // never destroyed, threads may outlive main
+    return *logger;
+  }
+
+  template <typename... Args>
+  static void Write(int level, const char *format, Args... args)
+  {
+    static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS, "too many log arguments");
+    LogRing &ring = ThreadRing();
+    LogRecord *record = ring.reserve();
+    if (!record)
+      return;
+    record->format = format;
+    record->time = now();
+    record->level = (uint8_t)level;
+    record->argCount = 0;
+    record->textUsed = 0;
+    (record->capture(args), ...);
+    ring.commit();
+  }
+
+  // the calling thread's ring, created and registered on first use
+  static LogRing &ThreadRing()
+  {
+    thread_local LogRing *ring = nullptr;
+    if (!ring)
+    {
+      ring = new LogRing(); // kept after the thread exits so its records still get written
+      Logger &logger = Get();
+      std::lock_guard<std::mutex> lock(logger.mutex);
+      logger.rings.push_back(ring);
+    }
+    return *ring;
+  }
+
+  // writes everything logged so far; the flusher does this every few ms
+  void Flush();
+  // stops the flusher after a last flush; runs at exit
+  void Shutdown();
+
+private:
+  std::vector<LogRecord> pending;
+  std::vector<char> line;
+  uint64_t droppedRecords = 0;
+
+  static uint64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  static Logger *start();
+  void run();
+  void format(const LogRecord &record);
+};
+
+Logger *Logger::start()
+{
+  Logger *logger = new Logger();
+  logger->flusher = std::thread(&Logger::run, logger);
+  atexit([]
+         { Get().Shutdown(); });
+  return logger;
+}
+
+void Logger::run()
+{
+  while (!stopping.load(std::memory_order_acquire))
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    Flush();
+  }
+}
+
+void Logger::Shutdown()
+{
+  if (!stopping.exchange(true) && flusher.joinable())
+    flusher.join();
+  Flush();
+}
+
+void Logger::Flush()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  pending.clear();
+  for (LogRing *ring : rings)
+  {
+    droppedRecords += ring->dropped.exchange(0, std::memory_order_relaxed);
+    ring->drain([this](const LogRecord &record)
+                { pending.push_back(record); });
+  }
+  if (pending.empty() && !droppedRecords)
+    return;
+  // interleave the threads' messages in the order they were logged
+  std::stable_sort(pending.begin(), pending.end(), [](const LogRecord &a, const LogRecord &b)
+                   { return a.time < b.time; });
+  for (const LogRecord &record : pending)
+  {
+    format(record);
+    fwrite(line.data(), 1, line.size(), out);
+  }
+  if (droppedRecords)
+  {
+    fprintf(out, "[warn] %llu log messages dropped\n", (unsigned long long)droppedRecords);
+    droppedRecords = 0;
+  }
+  fflush(out);
+}
+
+// Renders record into line as printf would have: each conversion is handed
+// to snprintf on its own with its captured argument, the length modifier
+// rewritten to match how the argument was stored.
+void Logger::format(const LogRecord &record)
+{
+  static const char *const levelNames[] = {"debug", "info", "warn", "error"};
+  char buffer[256];
+  line.clear();
+  auto append = [this](const char *s, size_t n)
+  { line.insert(line.end(), s, s + n); };
+  int n = snprintf(buffer, sizeof(buffer), "[%9.3f %s] ", (record.time - epoch) / 1e9, levelNames[record.level]);
+  append(buffer, std::min((size_t)n, sizeof(buffer) - 1));
+
+  int next = 0;
+  for (const char *p = record.format; *p;)
+  {
+    if (*p != '%')
+    {
+      const char *end = strchr(p, '%');
+      size_t len = end ? (size_t)(end - p) : strlen(p);
+      append(p, len);
+      p += len;
+      continue;
+    }
+    if (p[1] == '%')
+    {
+      append("%", 1);
+      p += 2;
+      continue;
+    }
+    // flags, width and precision are kept, length modifiers dropped
+    char spec[32];
+    size_t specLen = 0;
+    const char *q = p;
+    spec[specLen++] = *q++;
+    while (*q && strchr("-+ #0123456789.", *q) && specLen < sizeof(spec) - 4)
+      spec[specLen++] = *q++;
+    while (*q && strchr("hlLqjzt", *q))
+      q++;
+    char conversion = *q;
+    if (!conversion || next >= record.argCount)
+    {
+      append(p, strlen(p)); // malformed or too few arguments: print the rest as is
+      break;
+    }
+    const LogArg &arg = record.args[next];
+    LogArgType type = record.types[next++];
+    if (strchr("diouxX", conversion))
+    {
+      spec[specLen++] = 'l';
+      spec[specLen++] = 'l';
+    }
+    spec[specLen++] = conversion;
+    spec[specLen] = 0;
+    if (type == LOG_ARG_STRING)
+      n = snprintf(buffer, sizeof(buffer), spec, record.text + arg.u);
+    else if (type == LOG_ARG_DOUBLE)
+      n = strchr("diouxXc", conversion) ? snprintf(buffer, sizeof(buffer), spec, (long long)arg.f) : snprintf(buffer, sizeof(buffer), spec, arg.f);
+    else if (type == LOG_ARG_POINTER)
+      n = snprintf(buffer, sizeof(buffer), "%p", arg.p);
+    else if (conversion == 'c')
+      n = snprintf(buffer, sizeof(buffer), spec, (int)arg.i);
+    else if (strchr("eEfFgGaA", conversion))
+      n = snprintf(buffer, sizeof(buffer), spec, type == LOG_ARG_INT ? (double)arg.i : (double)arg.u);
+    else if (conversion == 's')
+      n = snprintf(buffer, sizeof(buffer), "?");
+    else
+      n = snprintf(buffer, sizeof(buffer), spec, arg.u);
+    if (n > 0)
+      append(buffer, std::min((size_t)n, sizeof(buffer) - 1));
+    p = q + 1;
+  }
+  line.push_back('\n');
+}
+
+#endif
@@ -0,0 +1,612 @@
+#ifndef NAVIGATION_H
+#define NAVIGATION_H
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <queue>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include "tile_grid.h"
+#include "bitboard.h"
+
+static const glm::ivec2 navigationDirs[] = {
+    {1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+// index into navigationDirs of the reverse of dir
+static inline int oppositeDir(int dir) { return dir ^ 1; }
+
+// The maze reduced to the cells where there is a choice to make. A junction
+// is any walkable cell without exactly two exits; the cells between two
+// junctions form a corridor with one way on in each direction. Shortest paths
+// only have to be searched between junctions, with corridor lengths as edge
+// weights.
+struct JunctionGraph
+{
+  static constexpr int UNREACHABLE = 0x3fffffff;
+
+  struct Edge
+  {
+    int to = -1;    // junction at the far end, or -1 when there is no exit this way
+    int length = 0; // steps to it
+  };
+  // a corridor cell's way to each of the two junctions its corridor joins
+  struct Corridor
+  {
+    int node[2] = {-1, -1};
+    int distance[2] = {0, 0};
+    uint8_t dir[2] = {0, 0};   // exit from this cell towards node[k]
+    uint8_t leave[2] = {0, 0}; // exit from node[k] into the corridor
+  };
+
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> exits;      // per cell, bit i set when navigationDirs[i] is walkable
+  std::vector<int> nodeOf;         // per cell, its junction or -1
+  std::vector<int> nodeCell;       // per junction, its cell
+  std::vector<Edge> edges;         // per junction, one per direction
+  std::vector<Corridor> corridors; // per cell, set for walkable cells that aren't junctions
+
+  int nodeCount() const { return (int)nodeCell.size(); }
+
+  void Build(const TileGrid &tiles, uint8_t walkFlag);
+  // for a corridor cell entered moving along dir, the index of the one way
+  // on; -1 at junctions, or when dir didn't come through one of its exits
+  int Onward(glm::ivec2 cell, glm::vec2 dir) const;
+  // whether target is cell itself or another cell of the corridor through it
+  bool SameCorridor(glm::ivec2 cell, glm::ivec2 target) const;
+  // Dijkstra from target: dist[n] is the steps from junction n to it
+  void Distances(int target, std::vector<int> &dist) const;
+  // the exit from cell on a shortest path to target, given dist(n), target's
+  // Distances for junction n, or NavigationTable::NO_HOP; ties go to the
+  // lowest index, as in the dense table
+  template <typename Distance>
+  uint8_t BestExit(int cell, int target, Distance dist) const;
+
+private:
+  int addNode(int cell);
+  void walkEdges(int node);
+};
+
+void JunctionGraph::Build(const TileGrid &tiles, uint8_t walkFlag)
+{
+  width = tiles.width;
+  height = tiles.height;
+  const int count = width * height;
+  exits.assign(count, 0);
+  nodeOf.assign(count, -1);
+  nodeCell.clear();
+  edges.clear();
+  corridors.assign(count, Corridor());
+  for (int cell = 0; cell < count; cell++)
+  {
+    if (!(tiles.cells[cell] & walkFlag))
+      continue;
+    for (int i = 0; i < 4; i++)
+    {
+      glm::ivec2 next = glm::ivec2(cell % width, cell / width) + navigationDirs[i];
+      if (tiles.inBounds(next) && (tiles.cells[tiles.cellIndex(next)] & walkFlag))
+        exits[cell] |= 1 << i;
+    }
+  }
+
+  for (int cell = 0; cell < count; cell++)
+    if ((tiles.cells[cell] & walkFlag) && __builtin_popcount(exits[cell]) != 2)
+      addNode(cell);
+  for (int node = 0; node < nodeCount(); node++)
+    walkEdges(node);
+  // a loop of corridor with no junction on it gets one, so every walk ends
+  for (int cell = 0; cell < count; cell++)
+    if ((tiles.cells[cell] & walkFlag) && nodeOf[cell] < 0 && corridors[cell].node[0] < 0)
+      walkEdges(addNode(cell));
+}
+
+int JunctionGraph::addNode(int cell)
+{
+  nodeOf[cell] = nodeCount();
+  nodeCell.push_back(cell);
+  edges.resize(nodeCell.size() * 4);
+  return nodeOf[cell];
+}
+
+// follows each exit of node to the next junction, recording the way back
+// in every corridor cell passed
+void JunctionGraph::walkEdges(int node)
+{
+  const int start = nodeCell[node];
+  for (int i = 0; i < 4; i++)
+  {
+    if (!(exits[start] & (1 << i)))
+      continue;
+    glm::ivec2 cell = glm::ivec2(start % width, start / width) + navigationDirs[i];
+    int came = i;
+    int length = 1;
+    int index = cell.y * width + cell.x;
+    while (nodeOf[index] < 0)
+    {
+      Corridor &corridor = corridors[index];
+      int k = corridor.node[0] < 0 ? 0 : 1;
+      corridor.node[k] = node;
+      corridor.distance[k] = length;
+      corridor.dir[k] = (uint8_t)oppositeDir(came);
+      corridor.leave[k] = (uint8_t)i;
+      came = __builtin_ctz(exits[index] & ~(1 << oppositeDir(came)));
+      cell += navigationDirs[came];
+      index = cell.y * width + cell.x;
+      length++;
+    }
+    edges[node * 4 + i] = {nodeOf[index], length};
+  }
+}
+
+int JunctionGraph::Onward(glm::ivec2 cell, glm::vec2 dir) const
+{
+  if (cell.x < 0 || cell.y < 0 || cell.x >= width || cell.y >= height)
+    return -1;
+  int index = cell.y * width + cell.x;
+  if (nodeOf[index] >= 0)
+    return -1;
+  for (int i = 0; i < 4; i++)
+  {
+    if (glm::vec2(navigationDirs[i]) == -dir)
+    {
+      if (!(exits[index] & (1 << i)))
+        return -1;
+      return __builtin_ctz(exits[index] & ~(1 << i));
+    }
+  }
+  return -1;
+}
+
+bool JunctionGraph::SameCorridor(glm::ivec2 cell, glm::ivec2 target) const
+{
+  if (cell.x < 0 || cell.y < 0 || cell.x >= width || cell.y >= height ||
+      target.x < 0 || target.y < 0 || target.x >= width || target.y >= height)
+    return false;
+  int a = cell.y * width + cell.x;
+  int b = target.y * width + target.x;
+  if (a == b)
+    return true;
+  if (nodeOf[a] >= 0 || nodeOf[b] >= 0 || !exits[a] || !exits[b])
+    return false;
+  // a corridor is known by its two ends, in either order
+  const Corridor &from = corridors[a];
+  const Corridor &to = corridors[b];
+  for (int k = 0; k < 2; k++)
+    if (to.node[k] == from.node[0] && to.leave[k] == from.leave[0] &&
+        to.node[1 - k] == from.node[1] && to.leave[1 - k] == from.leave[1])
+      return true;
+  return false;
+}
+
+void JunctionGraph::Distances(int target, std::vector<int> &dist) const
+{
+  typedef std::pair<int, int> Entry; // distance, junction
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  dist.assign(nodeCount(), UNREACHABLE);
+  if (nodeOf[target] >= 0)
+  {
+    dist[nodeOf[target]] = 0;
+    queue.push({0, nodeOf[target]});
+  }
+  else
+  {
+    const Corridor &corridor = corridors[target];
+    for (int k = 0; k < 2; k++)
+    {
+      if (corridor.node[k] >= 0 && corridor.distance[k] < dist[corridor.node[k]])
+      {
+        dist[corridor.node[k]] = corridor.distance[k];
+        queue.push({corridor.distance[k], corridor.node[k]});
+      }
+    }
+  }
+  while (!queue.empty())
+  {
+    Entry entry = queue.top();
+    queue.pop();
+    if (entry.first > dist[entry.second])
+      continue;
+    for (int i = 0; i < 4; i++)
+    {
+      const Edge &edge = edges[entry.second * 4 + i];
+      if (edge.to >= 0 && entry.first + edge.length < dist[edge.to])
+      {
+        dist[edge.to] = entry.first + edge.length;
+        queue.push({dist[edge.to], edge.to});
+      }
+    }
+  }
+}
+
+template <typename Distance>
+uint8_t JunctionGraph::BestExit(int cell, int target, Distance dist) const
+{
+  const uint8_t NONE = 0xFF;
+  if (cell == target || !exits[cell])
+    return NONE;
+  const Corridor *onTarget = nodeOf[target] < 0 ? &corridors[target] : nullptr;
+  int best = UNREACHABLE;
+  uint8_t bestDir = NONE;
+  auto consider = [&](int cost, uint8_t dir)
+  {
+    if (cost < best || (cost == best && cost < UNREACHABLE && dir < bestDir))
+    {
+      best = cost;
+      bestDir = dir;
+    }
+  };
+
+  if (nodeOf[cell] >= 0)
+  {
+    int node = nodeOf[cell];
+    for (int i = 0; i < 4; i++)
+    {
+      const Edge &edge = edges[node * 4 + i];
+      if (edge.to < 0)
+        continue;
+      int cost = std::min(UNREACHABLE, edge.length + dist(edge.to));
+      // the target may sit on this very corridor
+      for (int j = 0; onTarget && j < 2; j++)
+        if (onTarget->node[j] == node && onTarget->leave[j] == i)
+          cost = std::min(cost, onTarget->distance[j]);
+      consider(cost, (uint8_t)i);
+    }
+    return bestDir;
+  }
+
+  const Corridor &corridor = corridors[cell];
+  for (int k = 0; k < 2; k++)
+  {
+    int cost = std::min(UNREACHABLE, corridor.distance[k] + dist(corridor.node[k]));
+    // the target is on this corridor, between here and node[k]
+    for (int j = 0; onTarget && j < 2; j++)
+      if (onTarget->node[j] == corridor.node[k] && onTarget->leave[j] == corridor.leave[k] &&
+          onTarget->distance[j] < corridor.distance[k])
+        cost = std::min(cost, corridor.distance[k] - onTarget->distance[j]);
+    consider(cost, corridor.dir[k]);
+  }
+  return bestDir;
+}
+
+// Next-hop directions towards every target of a static maze. A target's flow
+// field gives the step every cell takes towards it. Small mazes keep every
+// target's field in one dense table, a reverse BFS per target built up
+// front. Bigger ones search the junction graph on first use of a target,
+// keeping each junction's distance and step, and hold on to the most
+// recently used fields. Either way every ghost (and every game on the maze)
+// chasing the same tile shares one field.
+enum NavigationMode
+{
+  NAVIGATION_AUTO,       // dense up to MAX_DENSE_CELLS, flow fields past it
+  NAVIGATION_DENSE,      // every field, built up front
+  NAVIGATION_FLOW_FIELDS // fields built lazily, evicted by a clock sweep
+};
+
+struct NavigationTable
+{
+  static constexpr uint8_t NO_HOP = 0xFF;
+  // a dense table is MAX_DENSE_CELLS^2 bytes, 4 MB
+  static constexpr int MAX_DENSE_CELLS = 2048;
+
+  int width = 0;
+  int height = 0;
+  NavigationMode mode = NAVIGATION_DENSE;
+  // dense mode: nextHop[target * cellCount + source] is an index into dirs,
+  // or NO_HOP; each target's flow field is one contiguous row
+  std::vector<uint8_t> nextHop;
+
+  int cellCount() const { return width * height; }
+
+  bool inBounds(glm::ivec2 cell) const
+  {
+    return cell.x >= 0 && cell.y >= 0 && cell.x < width && cell.y < height;
+  }
+
+  int cellIndex(glm::ivec2 cell) const { return cell.y * width + cell.x; }
+
+  // walkFlag picks whose walkability to use, e.g. TILE_GHOST_WALKABLE;
+  // fieldCapacity is how many flow fields the lazy mode keeps
+  void Build(const TileGrid &tiles, uint8_t walkFlag, NavigationMode mode = NAVIGATION_AUTO, int fieldCapacity = 256);
+  // safe to call from several threads at once
+  glm::ivec2 NextStep(glm::ivec2 from, glm::ivec2 to) const;
+
+  // the maze's decision points, for following corridors without a lookup
+  JunctionGraph junctions;
+
+  // flow fields built so far in the lazy mode; every other lookup was a hit
+  uint64_t fieldsBuilt() const { return fields.built.load(std::memory_order_relaxed); }
+
+  // tables only depend on the walkable layout, so every game on the same
+  // maze shares one instead of building its own
+  static std::shared_ptr<const NavigationTable> Shared(const TileGrid &tiles, uint8_t walkFlag);
+
+private:
+  std::vector<uint8_t> open; // walkable cells
+  Bitboard openBoard;        // the same, when the maze fits a bitboard
+
+  // Fixed slots of junction-level flow fields. Hits don't lock: each slot is
+  // a seqlock whose version is odd while a miss rewrites it, so a reader
+  // that raced the rewrite sees the version move and retries under the
+  // mutex. Recency is a clock bit per slot, set by hits and swept by the
+  // miss looking for a slot to evict.
+  struct FieldCache
+  {
+    std::mutex mutex; // held by misses only
+    int capacity = 0;
+    int hand = 0;                                 // next slot the clock considers
+    std::vector<std::atomic<int>> distances;      // per slot, nodeCount distances to its target
+    std::vector<std::atomic<uint8_t>> hops;       // per slot, nodeCount exits towards it
+    std::vector<std::atomic<int>> slotTarget;     // target in each slot, -1 if free
+    std::vector<std::atomic<uint32_t>> version;   // per slot, odd while it is rewritten
+    std::vector<std::atomic<uint8_t>> referenced; // per slot, hit since the hand last passed
+    std::vector<std::atomic<int>> slotOf;         // per target cell, its slot or -1
+    std::vector<int> scratch;
+    std::vector<uint8_t> scratchHops;
+    std::atomic<uint64_t> built{0};
+  };
+  mutable FieldCache fields;
+
+  void buildField(int target, uint8_t *field, std::vector<int> &dist) const;
+  void buildFieldWithBitboards(int target, uint8_t *field) const;
+  void buildFieldWithQueue(int target, uint8_t *field, std::vector<int> &dist) const;
+  int fillSlot(int target) const;
+  uint8_t readHop(int slot, int source, int target) const;
+  uint8_t lazyHop(int source, int target) const;
+};
+
+// atomics can't be copied, so resizing a vector of them means replacing it
+template <typename T>
+static void resetAtomics(std::vector<std::atomic<T>> &v, size_t size, T value)
+{
+  std::vector<std::atomic<T>>(size).swap(v);
+  for (std::atomic<T> &a : v)
+    a.store(value, std::memory_order_relaxed);
+}
+
+void NavigationTable::Build(const TileGrid &tiles, uint8_t walkFlag, NavigationMode mode, int fieldCapacity)
+{
+  height = tiles.height;
+  width = tiles.width;
+  const int count = cellCount();
+  open.assign(count, 0);
+  for (int i = 0; i < count; i++)
+    open[i] = (tiles.cells[i] & walkFlag) != 0;
+  if (Bitboard::Fits(width, height))
+    openBoard = Bitboard::FromTiles(tiles, walkFlag);
+  junctions.Build(tiles, walkFlag);
+
+  if (mode == NAVIGATION_AUTO)
+    mode = count <= MAX_DENSE_CELLS ? NAVIGATION_DENSE : NAVIGATION_FLOW_FIELDS;
+  this->mode = mode;
+
+  std::lock_guard<std::mutex> lock(fields.mutex);
+  fields.built = 0;
+  if (mode == NAVIGATION_DENSE)
+  {
+    nextHop.assign((size_t)count * count, NO_HOP);
+    std::vector<int> dist;
+    for (int target = 0; target < count; target++)
+      if (open[target])
+        buildField(target, &nextHop[(size_t)target * count], dist);
+    fields.capacity = 0;
+    resetAtomics(fields.distances, 0, 0);
+    resetAtomics(fields.hops, 0, (uint8_t)0);
+    resetAtomics(fields.slotOf, 0, 0);
+    return;
+  }
+
+  std::vector<uint8_t>().swap(nextHop);
+  const int nodes = junctions.nodeCount();
+  fields.capacity = std::max(1, fieldCapacity);
+  fields.hand = 0;
+  resetAtomics(fields.distances, (size_t)fields.capacity * nodes, JunctionGraph::UNREACHABLE);
+  resetAtomics(fields.hops, (size_t)fields.capacity * nodes, NO_HOP);
+  resetAtomics(fields.slotTarget, fields.capacity, -1);
+  resetAtomics(fields.version, fields.capacity, 0u);
+  resetAtomics(fields.referenced, fields.capacity, (uint8_t)0);
+  resetAtomics(fields.slotOf, count, -1);
+}
+
+void NavigationTable::buildField(int target, uint8_t *field, std::vector<int> &dist) const
+{
+  if (Bitboard::Fits(width, height))
+    buildFieldWithBitboards(target, field);
+  else
+    buildFieldWithQueue(target, field, dist);
+}
+
+// Reverse BFS from target done a whole frontier at a time. Layer k holds the
+// cells k steps from the target; a cell in layer k steps in the first
+// direction whose neighbour is in layer k - 1.
+void NavigationTable::buildFieldWithBitboards(int target, uint8_t *field) const
+{
+  Bitboard previous;
+  previous.set(glm::ivec2(target % width, target / width));
+  Bitboard visited = previous;
+  while (true)
+  {
+    Bitboard layer = previous.expand(openBoard).without(visited);
+    if (!layer.any())
+      break;
+    visited = visited | layer;
+    Bitboard unassigned = layer;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+      Bitboard stepping = unassigned & previous.neighbors(navigationDirs[i]);
+      stepping.forEach([&](glm::ivec2 source)
+                       { field[cellIndex(source)] = i; });
+      unassigned = unassigned.without(stepping);
+    }
+    previous = layer;
+  }
+}
+
+// one reverse BFS gives the distance of every cell to target; the next hop
+// from a cell is then the first neighbour one step closer
+void NavigationTable::buildFieldWithQueue(int target, uint8_t *field, std::vector<int> &dist) const
+{
+  const int count = cellCount();
+  dist.assign(count, -1);
+  std::queue<glm::ivec2> q;
+  dist[target] = 0;
+  q.push({target % width, target / width});
+  while (!q.empty())
+  {
+    glm::ivec2 cur = q.front();
+    q.pop();
+    int curDist = dist[cellIndex(cur)];
+    for (auto d : navigationDirs)
+    {
+      glm::ivec2 next = cur + d;
+      if (!inBounds(next))
+        continue;
+      int n = cellIndex(next);
+      if (!open[n] || dist[n] != -1)
+        continue;
+      dist[n] = curDist + 1;
+      q.push(next);
+    }
+  }
+
+  for (int source = 0; source < count; source++)
+  {
+    if (dist[source] <= 0)
+      continue;
+    glm::ivec2 cell(source % width, source / width);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+      glm::ivec2 next = cell + navigationDirs[i];
+      if (inBounds(next) && dist[cellIndex(next)] == dist[source] - 1)
+      {
+        field[source] = i;
+        break;
+      }
+    }
+  }
+}
+
+// the hop from source in target's field, building the field if it isn't
+// cached; a hit reads the slot without locking and only falls back to the
+// mutex if a miss rewrote the slot while it was reading
+uint8_t NavigationTable::lazyHop(int source, int target) const
+{
+  int slot = fields.slotOf[target].load(std::memory_order_acquire);
+  if (slot >= 0)
+  {
+    uint32_t version = fields.version[slot].load(std::memory_order_acquire);
+    if (!(version & 1) && fields.slotTarget[slot].load(std::memory_order_relaxed) == target)
+    {
+      uint8_t hop = readHop(slot, source, target);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (fields.version[slot].load(std::memory_order_relaxed) == version)
+      {
+        // test first, so steady hits leave the line shared between cores
+        if (!fields.referenced[slot].load(std::memory_order_relaxed))
+          fields.referenced[slot].store(1, std::memory_order_relaxed);
+        return hop;
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(fields.mutex);
+  slot = fields.slotOf[target].load(std::memory_order_relaxed);
+  if (slot < 0)
+    slot = fillSlot(target);
+  fields.referenced[slot].store(1, std::memory_order_relaxed);
+  return readHop(slot, source, target);
+}
+
+// Builds target's field, one Dijkstra over the junctions and then the best
+// exit of each, into the first slot the clock hand finds unreferenced.
+// Called with the mutex held.
+int NavigationTable::fillSlot(int target) const
+{
+  const int nodes = junctions.nodeCount();
+  junctions.Distances(target, fields.scratch);
+  fields.scratchHops.resize(nodes);
+  for (int node = 0; node < nodes; node++)
+    fields.scratchHops[node] = junctions.BestExit(junctions.nodeCell[node], target, [this](int n)
+                                                  { return fields.scratch[n]; });
+
+  // hits keep setting bits while the hand sweeps, so give up after two turns
+  int slot = fields.hand;
+  for (int step = 0; step < 2 * fields.capacity; step++)
+  {
+    slot = fields.hand;
+    fields.hand = (fields.hand + 1) % fields.capacity;
+    if (!fields.referenced[slot].exchange(0, std::memory_order_relaxed))
+      break;
+  }
+
+  int evicted = fields.slotTarget[slot].load(std::memory_order_relaxed);
+  if (evicted >= 0)
+    fields.slotOf[evicted].store(-1, std::memory_order_relaxed);
+  uint32_t version = fields.version[slot].load(std::memory_order_relaxed);
+  fields.version[slot].store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  fields.slotTarget[slot].store(target, std::memory_order_relaxed);
+  for (int node = 0; node < nodes; node++)
+  {
+    fields.distances[(size_t)slot * nodes + node].store(fields.scratch[node], std::memory_order_relaxed);
+    fields.hops[(size_t)slot * nodes + node].store(fields.scratchHops[node], std::memory_order_relaxed);
+  }
+  fields.version[slot].store(version + 2, std::memory_order_release);
+  fields.slotOf[target].store(slot, std::memory_order_release);
+  fields.built.fetch_add(1, std::memory_order_relaxed);
+  return slot;
+}
+
+uint8_t NavigationTable::readHop(int slot, int source, int target) const
+{
+  const int nodes = junctions.nodeCount();
+  int node = junctions.nodeOf[source];
+  if (node >= 0)
+    return fields.hops[(size_t)slot * nodes + node].load(std::memory_order_relaxed);
+  // corridor cells pick between their two ends
+  const std::atomic<int> *dist = &fields.distances[(size_t)slot * nodes];
+  return junctions.BestExit(source, target, [dist](int n)
+                            { return dist[n].load(std::memory_order_relaxed); });
+}
+
+std::shared_ptr<const NavigationTable> NavigationTable::Shared(const TileGrid &tiles, uint8_t walkFlag)
+{
+  static std::mutex cacheMutex;
+  static std::map<std::string, std::shared_ptr<const NavigationTable>> cache;
+
+  std::string layout = std::to_string(tiles.width) + 'x' + std::to_string(tiles.height) + ':';
+  for (uint8_t cell : tiles.cells)
+    layout += (cell & walkFlag) ? '1' : '0';
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  auto &table = cache[layout];
+  if (!table)
+  {
+    auto built = std::make_shared<NavigationTable>();
+    built->Build(tiles, walkFlag);
+    table = built;
+  }
+  return table;
+}
+
+// Returns the unit step to take from `from` towards `to`, or (0, 0) when
+// already there or the target is unreachable.
+glm::ivec2 NavigationTable::NextStep(glm::ivec2 from, glm::ivec2 to) const
+{
+  if (!inBounds(from) || !inBounds(to))
+    return glm::ivec2(0, 0);
+  int target = cellIndex(to);
+  if (!open[target])
+    return glm::ivec2(0, 0);
+  uint8_t hop = mode == NAVIGATION_DENSE ? nextHop[(size_t)target * cellCount() + cellIndex(from)] : lazyHop(cellIndex(from), target);
+  if (hop == NO_HOP)
+    return glm::ivec2(0, 0);
+  return navigationDirs[hop];
+}
+
+#endif
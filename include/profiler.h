@@ -0,0 +1,286 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Scoped-zone profiler. PROFILE_ZONE("name") times the rest of the enclosing
+// scope and pushes the event into a lock-free ring owned by the calling
+// thread. Profiler::Collect drains every ring (from one thread, e.g. once a
+// frame) into per-zone statistics and, optionally, a Chrome trace.
+// Build with -DPACMAN_PROFILE=0 to compile the zones out entirely.
+#ifndef PACMAN_PROFILE
+#define PACMAN_PROFILE 1
+#endif
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#if PACMAN_PROFILE
+// name must be a string with static storage, e.g. a literal
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#endif
+
+// times are in Profiler::Now ticks until Report/WriteChromeTrace convert them
+struct ProfileEvent
+{
+  const char *name;
+  uint64_t start;
+  uint64_t duration;
+};
+
+// single producer (the owning thread), single consumer (the collector)
+struct ProfileRing
+{
+  static constexpr uint32_t CAPACITY = 1 << 14;
+
+  ProfileEvent events[CAPACITY];
+  std::atomic<uint32_t> head{0}; // next write, owned by the producer
+  std::atomic<uint32_t> tail{0}; // next read, owned by the consumer
+  std::atomic<uint64_t> dropped{0};
+  uint32_t threadId = 0;
+
+  void push(const ProfileEvent &event)
+  {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == CAPACITY)
+    {
+      // full: drop rather than block the hot path
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    events[h % CAPACITY] = event;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  template <typename Fn>
+  void drain(Fn fn)
+  {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    for (; t != h; t++)
+      fn(events[t % CAPACITY]);
+    tail.store(t, std::memory_order_release);
+  }
+};
+
+struct Profiler
+{
+  // log-scale histogram: 16 sub-buckets per power of two ticks
+  static constexpr int SUB_BUCKETS = 16;
+  static constexpr int BUCKETS = 64 * SUB_BUCKETS;
+
+  struct ZoneStats
+  {
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+    std::vector<uint32_t> histogram = std::vector<uint32_t>(BUCKETS, 0);
+  };
+
+  struct TraceEvent
+  {
+    const char *name;
+    uint32_t threadId;
+    uint64_t start;
+    uint64_t duration;
+  };
+
+  std::mutex mutex;
+  std::vector<ProfileRing *> rings;
+  std::unordered_map<const char *, ZoneStats> zones; // keyed by the name pointer, merged by text in Report
+  std::vector<TraceEvent> trace;
+  bool traceEnabled = false;
+  size_t maxTraceEvents = 1 << 20;
+  uint64_t droppedEvents = 0;
+
+  static Profiler &Get()
+  {
+    static Profiler *profiler = new Profiler(); // never destroyed, threads may outlive main
+    return *profiler;
+  }
+
+  // the TSC where there is one: a zone then costs two unserialized reads
+  // instead of two clock_gettime calls
+  static uint64_t Now()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  // the calling thread's ring, created and registered on first use
+  static ProfileRing &ThreadRing()
+  {
+    thread_local ProfileRing *ring = nullptr;
+    if (!ring)
+    {
+      ring = new ProfileRing(); // kept after the thread exits so its events can still be drained
+      Profiler &profiler = Get();
+      std::lock_guard<std::mutex> lock(profiler.mutex);
+      ring->threadId = (uint32_t)profiler.rings.size();
+      profiler.rings.push_back(ring);
+    }
+    return *ring;
+  }
+
+  // start keeping drained events for WriteChromeTrace, up to maxEvents
+  void EnableTrace(size_t maxEvents = 1 << 20)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    traceEnabled = true;
+    maxTraceEvents = maxEvents;
+  }
+
+  void Collect();
+  void Report(FILE *out);
+  bool WriteChromeTrace(const char *path);
+
+private:
+  uint64_t epochTicks = Now();
+  std::chrono::steady_clock::time_point epochTime = std::chrono::steady_clock::now();
+
+  double nanosPerTick() const;
+  static int bucketFor(uint64_t ticks);
+  static uint64_t bucketUpperBound(int bucket);
+};
+
+struct ProfileZone
+{
+  const char *name;
+  uint64_t start;
+
+  explicit ProfileZone(const char *name) : name(name), start(Profiler::Now()) {}
+  ~ProfileZone()
+  {
+    Profiler::ThreadRing().push({name, start, Profiler::Now() - start});
+  }
+};
+
+// measured against steady_clock over the whole run so far
+double Profiler::nanosPerTick() const
+{
+  uint64_t ticks = Now() - epochTicks;
+  double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - epochTime).count();
+  return ticks ? nanos / ticks : 1.0;
+}
+
+int Profiler::bucketFor(uint64_t ticks)
+{
+  if (ticks < SUB_BUCKETS)
+    return (int)ticks;
+  int power = 63 - __builtin_clzll(ticks);
+  int sub = (int)((ticks >> (power - 4)) & (SUB_BUCKETS - 1));
+  int bucket = (power - 3) * SUB_BUCKETS + sub;
+  return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+uint64_t Profiler::bucketUpperBound(int bucket)
+{
+  if (bucket < SUB_BUCKETS)
+    return bucket;
+  int power = bucket / SUB_BUCKETS + 3;
+  int sub = bucket % SUB_BUCKETS;
+  return ((uint64_t)(SUB_BUCKETS + sub + 1) << (power - 4)) - 1;
+}
+
+void Profiler::Collect()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (ProfileRing *ring : rings)
+  {
+    droppedEvents += ring->dropped.exchange(0, std::memory_order_relaxed);
+    ring->drain([&](const ProfileEvent &event)
+                {
+      ZoneStats &stats = zones[event.name];
+      stats.count++;
+      stats.total += event.duration;
+      stats.min = std::min(stats.min, event.duration);
+      stats.max = std::max(stats.max, event.duration);
+      stats.histogram[bucketFor(event.duration)]++;
+      if (traceEnabled && trace.size() < maxTraceEvents)
+        trace.push_back({event.name, ring->threadId, event.start, event.duration}); });
+  }
+}
+
+// min/avg/p99/max per zone; p99 is the upper edge of its histogram bucket (within ~6%)
+void Profiler::Report(FILE *out)
+{
+  Collect();
+  std::lock_guard<std::mutex> lock(mutex);
+  double us = nanosPerTick() / 1000.0;
+  std::map<std::string, ZoneStats> merged;
+  for (auto &entry : zones)
+  {
+    ZoneStats &stats = merged[entry.first];
+    stats.count += entry.second.count;
+    stats.total += entry.second.total;
+    stats.min = std::min(stats.min, entry.second.min);
+    stats.max = std::max(stats.max, entry.second.max);
+    for (int b = 0; b < BUCKETS; b++)
+      stats.histogram[b] += entry.second.histogram[b];
+  }
+  fprintf(out, "%-32s %10s %10s %10s %10s %10s\n", "zone", "calls", "min us", "avg us", "p99 us", "max us");
+  for (auto &entry : merged)
+  {
+    const ZoneStats &stats = entry.second;
+    uint64_t rank = stats.count - stats.count / 100;
+    uint64_t seen = 0;
+    uint64_t p99 = stats.max;
+    for (int b = 0; b < BUCKETS; b++)
+    {
+      seen += stats.histogram[b];
+      if (seen >= rank)
+      {
+        p99 = std::min(bucketUpperBound(b), stats.max);
+        break;
+      }
+    }
+    fprintf(out, "%-32s %10llu %10.2f %10.2f %10.2f %10.2f\n", entry.first.c_str(), (unsigned long long)stats.count,
+            stats.min * us, stats.total * us / stats.count, p99 * us, stats.max * us);
+  }
+  if (droppedEvents)
+    fprintf(out, "%llu events dropped, collect more often\n", (unsigned long long)droppedEvents);
+}
+
+// chrome://tracing / Perfetto JSON with one complete ("X") event per zone
+bool Profiler::WriteChromeTrace(const char *path)
+{
+  Collect();
+  FILE *file = fopen(path, "w");
+  if (!file)
+  {
+    printf("Failed to open trace file: %s\n", path);
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  double us = nanosPerTick() / 1000.0;
+  fprintf(file, "{\"traceEvents\":[\n");
+  for (size_t i = 0; i < trace.size(); i++)
+  {
+    const TraceEvent &event = trace[i];
+    fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+            event.name, event.threadId, (event.start - epochTicks) * us, event.duration * us,
+            i + 1 < trace.size() ? "," : "");
+  }
+  fprintf(file, "]}\n");
+  fclose(file);
+  return true;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// PCG32 (XSH RR): 16 bytes of state, a handful of ALU ops per number, and
+// the same sequence on every platform for a given seed and stream. Each
+// simulation owns one, so games never share state or contend across threads.
+struct Rng
+{
+  uint64_t state = 0x853c49e6748fea9bull;
+  uint64_t inc = 0xda3e39cb94b95bdbull; // always odd; selects the stream
+
+  Rng() {}
+  explicit Rng(uint64_t seed, uint64_t stream = 0) { Seed(seed, stream); }
+
+  // different streams give independent sequences for the same seed
+  void Seed(uint64_t seed, uint64_t stream = 0)
+  {
+    state = 0;
+    inc = (stream << 1) | 1;
+    next();
+    state += seed;
+    next();
+  }
+
+  uint32_t next()
+  {
+    uint64_t old = state;
+    state = old * 6364136223846793005ull + inc;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+  }
+
+  // uniform in [0, bound) without modulo bias (Lemire's multiply-shift)
+  uint32_t below(uint32_t bound)
+  {
+    uint64_t m = (uint64_t)next() * bound;
+    if ((uint32_t)m < bound)
+    {
+      uint32_t threshold = (0u - bound) % bound;
+      while ((uint32_t)m < threshold)
+        m = (uint64_t)next() * bound;
+    }
+    return (uint32_t)(m >> 32);
+  }
+};
+
+#endif
@@ -2,16 +2,29 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+
+// location of a uniform of GLSL type T in one program; -1 (ignored by GL)
+// when the program has no such active uniform
+template <typename T>
+struct Uniform
+{
+    int location = -1;
+};
 
 class Shader
 {
 public:
     unsigned int ID;
+    // every active uniform's location, reflected once after linking
+    std::unordered_map<std::string, int> uniformLocations;
     Shader() {}
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
@@ -45,9 +58,80 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
+        compile(vertexCode.c_str(), fragmentCode.c_str());
+    }
+    // builds the program from source already in memory, e.g. an asset pack
+    // ------------------------------------------------------------------------
+    static Shader FromSource(const char* vShaderCode, const char* fShaderCode)
+    {
+        Shader shader;
+        shader.compile(vShaderCode, fShaderCode);
+        return shader;
+    }
+    // activate the shader
+    // ------------------------------------------------------------------------
+    void use() 
+    { 
+        glUseProgram(ID); 
+    }
+    // cached location of the named uniform, -1 if it isn't active
+    // ------------------------------------------------------------------------
+    int location(const std::string &name) const
+    {
+        auto it = uniformLocations.find(name);
+        return it != uniformLocations.end() ? it->second : -1;
+    }
+    // typed handle to look up once and set every frame
+    // ------------------------------------------------------------------------
+    template <typename T>
+    Uniform<T> uniform(const std::string &name) const
+    {
+        return Uniform<T>{location(name)};
+    }
+    // handle setters; they write to this program whether or not it is in use
+    // ------------------------------------------------------------------------
+    void set(Uniform<bool> uniform, bool value) const { glProgramUniform1i(ID, uniform.location, (int)value); }
+    void set(Uniform<int> uniform, int value) const { glProgramUniform1i(ID, uniform.location, value); }
+    void set(Uniform<float> uniform, float value) const { glProgramUniform1f(ID, uniform.location, value); }
+    void set(Uniform<glm::vec2> uniform, const glm::vec2 &value) const { glProgramUniform2fv(ID, uniform.location, 1, glm::value_ptr(value)); }
+    void set(Uniform<glm::vec4> uniform, const glm::vec4 &value) const { glProgramUniform4fv(ID, uniform.location, 1, glm::value_ptr(value)); }
+    void set(Uniform<glm::mat4> uniform, const glm::mat4 &value) const { glProgramUniformMatrix4fv(ID, uniform.location, 1, GL_FALSE, glm::value_ptr(value)); }
+    // utility uniform functions
+    // ------------------------------------------------------------------------
+    void setBool(const std::string &name, bool value) const
+    {         
+        set(uniform<bool>(name), value); 
+    }
+    // ------------------------------------------------------------------------
+    void setInt(const std::string &name, int value) const
+    { 
+        set(uniform<int>(name), value); 
+    }
+    // ------------------------------------------------------------------------
+    void setFloat(const std::string &name, float value) const
+    { 
+        set(uniform<float>(name), value); 
+    }
+    // ------------------------------------------------------------------------
+    void setMat4(const std::string &name, const glm::mat4 &value) const
+    { 
+        set(uniform<glm::mat4>(name), value); 
+    }
+    // attaches the named uniform block to a buffer binding point
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const char *name, unsigned int binding) const
+    {
+        unsigned int index = glGetUniformBlockIndex(ID, name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+
+private:
+    // compiles and links the program from vertex and fragment source
+    // ------------------------------------------------------------------------
+    void compile(const char* vShaderCode, const char* fShaderCode)
+    {
         unsigned int vertex, fragment;
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -65,34 +149,35 @@ public:
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        reflectUniforms();
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
     }
-    // activate the shader
-    // ------------------------------------------------------------------------
-    void use() 
-    { 
-        glUseProgram(ID); 
-    }
-    // utility uniform functions
-    // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
-    {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
-    }
-    // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
-    { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
-    }
+    // records the location of every active uniform outside a block; arrays
+    // are stored under both "name" and "name[0]"
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
-    { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    void reflectUniforms()
+    {
+        uniformLocations.clear();
+        int count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::string name(maxLength, '\0');
+        for (int i = 0; i < count; i++)
+        {
+            int length = 0, size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+            std::string uniformName = name.substr(0, length);
+            int location = glGetUniformLocation(ID, uniformName.c_str());
+            if (location < 0)
+                continue; // a member of a uniform block
+            uniformLocations[uniformName] = location;
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+                uniformLocations[uniformName.substr(0, uniformName.size() - 3)] = location;
+        }
     }
-
-private:
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
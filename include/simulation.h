@@ -0,0 +1,646 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <map>
+#include <type_traits>
+#include <string.h>
+#include <glm/glm.hpp>
+#include "tile_grid.h"
+#include "bitboard.h"
+#include "navigation.h"
+#include "profiler.h"
+#include "logger.h"
+#include "rng.h"
+#include "ghost_arrays.h"
+
+enum GAME_STATE
+{
+  GAME_ACTIVE,
+  GAME_MENU,
+  GAME_WIN
+};
+
+// profiler zone per ghost type, indexed by GhostType
+const char *const ghostZoneNames[] = {
+    "steerGhost BLINKY",
+    "steerGhost PINKY",
+    "steerGhost INKY",
+    "steerGhost CLYDE"};
+// games with more ghosts than this only time the whole steering pass
+const size_t STEER_ZONE_MAX_GHOSTS = 16;
+
+struct Pacman
+{
+  glm::vec2 position = glm::vec2(0.0f, 0.0f);
+  glm::vec2 previousPosition = glm::vec2(0.0f, 0.0f); // for render interpolation
+  glm::vec2 direction = glm::vec2(0.0f, 0.0f);
+  glm::vec2 velocity = glm::vec2(0.0f, 0.0f);
+  float speed = 0.0f;
+  float animationTime = 0.0f;
+  glm::ivec2 currentTile;
+
+  // animation state, the renderer maps it to a texture
+  glm::vec2 facing = glm::vec2(1.0f, 0.0f);
+  int frame = 0;
+  int animationClock = 0;
+
+  void updateAnimation(float deltaTime)
+  {
+    animationTime += deltaTime;
+    if (animationTime >= 0.1f)
+    { // change frame every 0.1 seconds
+      animationClock = (animationClock + 1) % 3;
+      if (direction != glm::vec2(0.0f, 0.0f))
+      {
+        facing = direction;
+        frame = animationClock;
+      }
+      animationTime = 0.0f;
+    }
+  }
+};
+
+const std::vector<std::string> defaultMaze = {
+    "############################",
+    "#............##............#",
+    "#.####.#####.##.#####.####.#",
+    "#.####.#####.##.#####.####.#",
+    "#.####.#####.##.#####.####.#",
+    "#..........................#",
+    "#.####.##.########.##.####.#",
+    "#......##....##....##......#",
+    "######.##### ## #####.######",
+    "     #.##### ## #####.#     ",
+    "     #.##          ##.#     ",
+    "     #.## ###--### ##.#     ",
+    "######.## #      # ##.######",
+    "#     .   #      #   .     #",
+    "######.## # IBPC # ##.######",
+    "     #.## ######## ##.#     ",
+    "     #.##          ##.#     ",
+    "     #.## ######## ##.#     ",
+    "######.## ######## ##.######",
+    "#............##............#",
+    "#.####.#####.##.#####.####.#",
+    "#...##................##...#",
+    "###.##.##.########.##.##.###",
+    "#......##....##....##......#",
+    "#.##########.##.##########.#",
+    "#.*......................A.#",
+    "############################"};
+
+// across x down copies of the default maze, joined through the outer walls
+// on the long open row and the leftmost column, for boards bigger than the
+// arcade one; every copy keeps its ghost house and markers
+std::vector<std::string> tiledMaze(int across, int down)
+{
+  const int width = (int)defaultMaze[0].size();
+  const int height = (int)defaultMaze.size();
+  std::vector<std::string> rows;
+  for (int j = 0; j < down; j++)
+    for (const std::string &row : defaultMaze)
+    {
+      std::string line;
+      for (int i = 0; i < across; i++)
+        line += row;
+      rows.push_back(line);
+    }
+  for (int j = 0; j < down; j++)
+    for (int i = 0; i < across; i++)
+    {
+      if (i + 1 < across)
+      {
+        rows[j * height + 5][i * width + width - 1] = ' ';
+        rows[j * height + 5][(i + 1) * width] = ' ';
+      }
+      if (j + 1 < down)
+      {
+        rows[j * height + height - 1][i * width + 1] = ' ';
+        rows[(j + 1) * height][i * width + 1] = ' ';
+      }
+    }
+  return rows;
+}
+
+// Everything a Simulation needs to continue from a given tick, as one
+// fixed-size trivially copyable blob: cloning or rolling back a game is a
+// memcpy. Boards up to 32x32 and up to MAX_GHOSTS ghosts fit. The maze
+// layout, navigation table and pixel geometry are not included, so a
+// snapshot only restores into a simulation built with the same ones.
+struct SimulationSnapshot
+{
+  static constexpr int MAX_CELLS = Bitboard::SIZE * Bitboard::SIZE;
+  static constexpr int MAX_GHOSTS = 16;
+
+  float score;
+  float gameTime;
+  float globalModeTimer;
+  float frightenedUntil;
+  int32_t state;
+  uint32_t events;
+  int32_t width;
+  int32_t height;
+  int32_t ghostCount;
+  Rng rng;
+  Pacman pacman;
+  Ghost ghosts[MAX_GHOSTS];
+  Bitboard pelletBoard;
+  Bitboard powerPelletBoard;
+  uint8_t cells[MAX_CELLS];
+};
+static_assert(std::is_trivially_copyable<SimulationSnapshot>::value, "snapshots are copied as raw bytes");
+
+// bits raised in Simulation::events during a PhysicsUpdate, so front ends can
+// react (sounds, effects) without the simulation knowing about them
+enum SimulationEvent
+{
+  EVENT_PELLET_EATEN = 1 << 0,
+  EVENT_FRUIT_EATEN = 1 << 1,
+  EVENT_POWER_PELLET_EATEN = 1 << 2,
+  EVENT_GHOST_EATEN = 1 << 3,
+  EVENT_PACMAN_CAUGHT = 1 << 4
+};
+
+// Game rules and state only: no window, GL context or sound engine needed.
+struct Simulation
+{
+  float score = 0.0f;
+  float tileSize = 32.0f;
+  float startX = 200.0f;
+  float startY = 200.0f;
+  float gameTime = 0.0f;
+  Pacman pacman;
+  const std::vector<std::string> *layout = &defaultMaze; // level source, reloaded by Reset
+  TileGrid tiles;
+  // pellet cells as bitboards, kept in step with tiles when the maze fits one
+  Bitboard pelletBoard;
+  Bitboard powerPelletBoard;
+  // cells whose contents changed since Reset, for renderers that only patch
+  // what changed; whoever consumes them clears the list
+  std::vector<int> changedTiles;
+  unsigned int boardGeneration = 0; // bumped by every Reset, the whole board was reloaded
+  GAME_STATE state = GAME_MENU;
+
+  // ghosts
+  // what Reset spawns, see GhostSpawn; left empty, every marker on the map
+  // spawns a ghost of its type
+  std::vector<GhostSpawn> roster{std::begin(classicGhosts), std::end(classicGhosts)};
+  GhostArrays ghosts;
+  std::shared_ptr<const NavigationTable> navigation;
+
+  float frightenedUntil = 0.0f;
+  float globalModeTimer = 0.0f;
+
+  unsigned int events = 0;
+
+  // frightened ghosts' turns; the seed alone decides them, so runs replay bit for bit
+  Rng rng;
+
+  explicit Simulation(uint64_t seed = 0);
+  void Reset();
+  void PhysicsUpdate(float deltaTime, glm::vec2 &desiredDir);
+  glm::ivec2 pxToCell(glm::vec2 p) const;
+  glm::vec2 cellToPx(glm::ivec2 cell) const;
+  int remainingPellets() const;
+  // false when the board or the ghost count is too big for a snapshot
+  bool Snapshot(SimulationSnapshot &out) const;
+  void Restore(const SimulationSnapshot &in);
+  // FNV-1a over the gameplay state, to check that two runs ended identically
+  uint64_t StateHash() const;
+
+protected:
+  const std::vector<std::string> *navigationLayout = nullptr; // the layout navigation was built for
+
+  void updatePacmanPhysics(float deltaTime, glm::vec2 &desiredDir);
+  // steers the ghosts at a cell center, then moves them all
+  void updateGhostPhysics(float deltaTime);
+  // picks a new direction for ghost i; it must be at the center of its cell
+  void steerGhost(size_t i);
+  void locateGhosts();
+  bool centerAligned(glm::vec2 tilePx, glm::vec2 position, glm::vec2 velocity);
+  void clearTile(glm::ivec2 cell, uint8_t flags);
+};
+
+glm::ivec2 Simulation::pxToCell(glm::vec2 p) const
+{
+  float fx = (p.x - startX) / tileSize;
+  float fy = (p.y - startY) / tileSize;
+  return {(int)std::round(fx), (int)std::round(fy)};
+}
+
+Simulation::Simulation(uint64_t seed) : rng(seed)
+{
+  Reset();
+}
+
+void Simulation::Reset()
+{
+  score = 0.0f;
+  pacman.position = glm::vec2(0.0f, 0.0f);
+  pacman.direction = glm::vec2(0.0f, 0.0f);
+  pacman.velocity = glm::vec2(0.0f, 0.0f);
+  pacman.speed = tileSize * 8; // pixels per second
+  state = GAME_MENU;
+  gameTime = 0.0f;
+
+  tiles.Load(*layout);
+  changedTiles.clear();
+  boardGeneration++;
+  if (Bitboard::Fits(tiles.width, tiles.height))
+  {
+    pelletBoard = Bitboard::FromTiles(tiles, TILE_PELLET);
+    powerPelletBoard = Bitboard::FromTiles(tiles, TILE_POWER_PELLET);
+  }
+
+  // only pellets change within a layout, so the table survives resets until
+  // layout points at another maze
+  if (!navigation || layout != navigationLayout || navigation->width != tiles.width ||
+      navigation->height != tiles.height)
+  {
+    navigation = NavigationTable::Shared(tiles, TILE_GHOST_WALKABLE);
+    navigationLayout = layout;
+  }
+
+  ghosts.Clear();
+  std::vector<glm::ivec2> markers[4]; // ghost spawn cells by type, in reading order
+  const std::vector<std::string> &rows = *layout;
+  for (unsigned int y = 0; y < rows.size(); y++)
+  {
+    for (unsigned int x = 0; x < rows[y].length(); x++)
+    {
+      if (x == 14 && y == 16)
+      {
+        pacman.position = glm::vec2(startX + (x * tileSize), startY + (y * tileSize));
+        pacman.currentTile = glm::ivec2(x, y);
+      }
+      GhostType type;
+      if (ghostTypeForSymbol(rows[y][x], type))
+      {
+        markers[type].push_back(glm::ivec2(x, y));
+        if (roster.empty())
+          ghosts.Add(Ghost(classicGhosts[type].scatterCorner, type));
+      }
+    }
+  }
+
+  bool missing[4] = {};
+  for (const GhostSpawn &spawn : roster)
+  {
+    if (markers[spawn.type].empty())
+      missing[spawn.type] = true;
+    else
+      ghosts.Add(Ghost(spawn.scatterCorner, spawn.type));
+  }
+  for (int type = 0; type < 4; type++)
+    if (missing[type])
+      LOG_WARN("No %c marker on the map, leaving its ghosts out", ghostTypeToSymbol[type]);
+  ghosts.Link();
+
+  // the k-th ghost of a type goes on that type's k-th marker
+  size_t placed[4] = {};
+  for (size_t i = 0; i < ghosts.size(); i++)
+  {
+    const std::vector<glm::ivec2> &cells = markers[ghosts.type[i]];
+    ghosts.position[i] = cellToPx(cells[placed[ghosts.type[i]]++ % cells.size()]);
+    ghosts.housePosition[i] = ghosts.position[i];
+    ghosts.direction[i] = glm::ivec2(0, -1);
+    ghosts.velocity[i] = glm::vec2(0.0f, 0.0f);
+    ghosts.speed[i] = tileSize * 8; // pixels per second
+    ghosts.mode[i] = SCATTER;
+  }
+
+  // respawns are teleports, don't interpolate across them
+  pacman.previousPosition = pacman.position;
+  ghosts.previousPosition = ghosts.position;
+  locateGhosts();
+}
+
+glm::vec2 Simulation::cellToPx(glm::ivec2 cell) const
+{
+  float px = startX + cell.x * tileSize;
+  float py = startY + cell.y * tileSize;
+  return glm::vec2(px, py);
+}
+
+// pellets and power pellets left; none left wins the level
+int Simulation::remainingPellets() const
+{
+  if (Bitboard::Fits(tiles.width, tiles.height))
+    return pelletBoard.count() + powerPelletBoard.count();
+  int remaining = 0;
+  for (uint8_t cell : tiles.cells)
+    remaining += (cell & (TILE_PELLET | TILE_POWER_PELLET)) != 0;
+  return remaining;
+}
+
+bool Simulation::centerAligned(glm::vec2 tilePx, glm::vec2 position, glm::vec2 velocity)
+{
+  float epsilon = velocity == glm::vec2(0.0f, 0.0f) ? 0.1f : glm::length(velocity) * 0.5f;
+  return fabs(tilePx.x - position.x) < epsilon && fabs(tilePx.y - position.y) < epsilon;
+}
+
+bool Simulation::Snapshot(SimulationSnapshot &out) const
+{
+  if (tiles.cellCount() > SimulationSnapshot::MAX_CELLS || !Bitboard::Fits(tiles.width, tiles.height) ||
+      ghosts.size() > (size_t)SimulationSnapshot::MAX_GHOSTS)
+    return false;
+  out.score = score;
+  out.gameTime = gameTime;
+  out.globalModeTimer = globalModeTimer;
+  out.frightenedUntil = frightenedUntil;
+  out.state = state;
+  out.events = events;
+  out.width = tiles.width;
+  out.height = tiles.height;
+  out.ghostCount = (int32_t)ghosts.size();
+  out.rng = rng;
+  out.pacman = pacman;
+  for (size_t i = 0; i < ghosts.size(); i++)
+    out.ghosts[i] = ghosts.Get(i);
+  out.pelletBoard = pelletBoard;
+  out.powerPelletBoard = powerPelletBoard;
+  memcpy(out.cells, tiles.cells.data(), tiles.cells.size());
+  return true;
+}
+
+// no allocation once the simulation has held a snapshot of the same size
+void Simulation::Restore(const SimulationSnapshot &in)
+{
+  score = in.score;
+  gameTime = in.gameTime;
+  globalModeTimer = in.globalModeTimer;
+  frightenedUntil = in.frightenedUntil;
+  state = (GAME_STATE)in.state;
+  events = in.events;
+  tiles.width = in.width;
+  tiles.height = in.height;
+  tiles.cells.resize(in.width * in.height);
+  memcpy(tiles.cells.data(), in.cells, tiles.cells.size());
+  rng = in.rng;
+  pacman = in.pacman;
+  ghosts.Clear();
+  for (int i = 0; i < in.ghostCount; i++)
+    ghosts.Add(in.ghosts[i]);
+  ghosts.Link();
+  locateGhosts();
+  pelletBoard = in.pelletBoard;
+  powerPelletBoard = in.powerPelletBoard;
+  // the board may differ anywhere, renderers rebuild it
+  changedTiles.clear();
+  boardGeneration++;
+}
+
+uint64_t Simulation::StateHash() const
+{
+  uint64_t hash = 1469598103934665603ull;
+  auto mix = [&hash](const void *data, size_t size)
+  {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull;
+    }
+  };
+  mix(&score, sizeof(score));
+  mix(&gameTime, sizeof(gameTime));
+  mix(&state, sizeof(state));
+  mix(tiles.cells.data(), tiles.cells.size());
+  mix(&pacman.position, sizeof(pacman.position));
+  mix(&pacman.direction, sizeof(pacman.direction));
+  for (size_t i = 0; i < ghosts.size(); i++)
+  {
+    GhostMode mode = (GhostMode)ghosts.mode[i];
+    mix(&ghosts.position[i], sizeof(ghosts.position[i]));
+    mix(&ghosts.direction[i], sizeof(ghosts.direction[i]));
+    mix(&mode, sizeof(mode));
+    mix(&ghosts.frightenedUntil[i], sizeof(ghosts.frightenedUntil[i]));
+  }
+  mix(&rng.state, sizeof(rng.state));
+  return hash;
+}
+
+// removes flags from a cell and records it as changed
+void Simulation::clearTile(glm::ivec2 cell, uint8_t flags)
+{
+  if (!tiles.inBounds(cell))
+    return;
+  tiles.clear(cell, flags);
+  changedTiles.push_back(tiles.cellIndex(cell));
+}
+
+void Simulation::updatePacmanPhysics(float deltaTime, glm::vec2 &desiredDir)
+{
+  PROFILE_ZONE("updatePacmanPhysics");
+  pacman.currentTile = pxToCell(pacman.position);
+  glm::vec2 pacmanTilePx = cellToPx(pacman.currentTile);
+  bool isPacmanCenterAligned = centerAligned(pacmanTilePx, pacman.position, pacman.velocity);
+  uint8_t currentTileFlags = tiles.at(pacman.currentTile);
+
+  if (isPacmanCenterAligned)
+  {
+    pacman.position = pacmanTilePx; // Snap to center
+
+    if (currentTileFlags & TILE_PELLET)
+    {
+      events |= EVENT_PELLET_EATEN;
+      clearTile(pacman.currentTile, TILE_PELLET);
+      pelletBoard.reset(pacman.currentTile);
+      score += 10.0f;
+      LOG_DEBUG("Pellet eaten! Score: %.1f", score);
+    }
+    else if (currentTileFlags & TILE_FRUIT)
+    {
+      clearTile(pacman.currentTile, TILE_FRUIT);
+      score += 100.0f;
+      LOG_DEBUG("Apple eaten! Score: %.1f", score);
+      events |= EVENT_FRUIT_EATEN;
+    }
+    else if (currentTileFlags & TILE_POWER_PELLET)
+    {
+      clearTile(pacman.currentTile, TILE_POWER_PELLET);
+      powerPelletBoard.reset(pacman.currentTile);
+      score += 50.0f;
+      LOG_DEBUG("Big pellet eaten! Score: %.1f", score);
+      events |= EVENT_POWER_PELLET_EATEN;
+      for (size_t i = 0; i < ghosts.size(); i++)
+      {
+        ghosts.Frighten(i, gameTime + 7.0f); // frightened for 10 seconds
+      }
+    }
+
+    if ((currentTileFlags & (TILE_PELLET | TILE_POWER_PELLET)) && remainingPellets() == 0)
+    {
+      LOG_INFO("All pellets eaten! You win! Score: %.1f", score);
+      state = GAME_WIN;
+    }
+
+    if ((desiredDir.x != 0 || desiredDir.y != 0))
+    {
+      auto nextTile = pxToCell(pacman.position) + (glm::ivec2)desiredDir;
+      if (tiles.pacmanCanEnter(nextTile))
+      {
+        pacman.direction = desiredDir;
+        desiredDir = glm::vec2(0, 0);
+      }
+    }
+  }
+
+  pacman.velocity = pacman.direction * deltaTime * pacman.speed;
+  glm::ivec2 nextTile = pxToCell(pacman.position + pacman.velocity) + (glm::ivec2)pacman.direction;
+  if (!isPacmanCenterAligned || tiles.pacmanCanEnter(nextTile))
+  {
+    pacman.position += pacman.velocity;
+  }
+  else
+  {
+    pacman.direction = glm::vec2(0, 0);
+  }
+}
+
+// refreshes every ghost's cell and center alignment
+void Simulation::locateGhosts()
+{
+  LocateGhosts(ghosts, 0, ghosts.size(), glm::vec2(startX, startY), tileSize);
+}
+
+void Simulation::steerGhost(size_t i)
+{
+  glm::ivec2 ghostCurrenTile = ghosts.cell[i];
+  GhostType type = (GhostType)ghosts.type[i];
+  glm::ivec2 targetTile;
+  if (type == BLINKY)
+    targetTile = pacman.currentTile;
+  if (type == PINKY)
+    targetTile = pacman.currentTile + glm::ivec2(4 * (int)pacman.direction.x, 4 * (int)pacman.direction.y);
+  if (type == INKY)
+  {
+    int32_t blinky = ghosts.leader[i];
+    glm::ivec2 blinkyTile = blinky >= 0 ? ghosts.cell[blinky] : ghostCurrenTile;
+    glm::ivec2 vector = pacman.currentTile + glm::ivec2(2 * (int)pacman.direction.x, 2 * (int)pacman.direction.y) - blinkyTile;
+    targetTile = blinkyTile + vector;
+  }
+  if (type == CLYDE)
+  {
+    float distance = glm::length(glm::vec2(ghostCurrenTile - pacman.currentTile));
+    if (distance > 8.0f)
+      targetTile = pacman.currentTile;
+    else
+      targetTile = ghosts.scatterCorner[i];
+  }
+  
+  if (ghosts.mode[i] == SCATTER)
+    targetTile = ghosts.scatterCorner[i];
+
+  if (ghosts.mode[i] == EATEN)
+    targetTile = pxToCell(ghosts.housePosition[i]);
+
+  static const glm::ivec2 dirs[] = {
+      {1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+  ghosts.position[i] = cellToPx(ghostCurrenTile); // Snap to center
+  // between junctions there is only one way on, so nothing to decide, unless
+  // the target is on this corridor: it may be behind, or right here
+  int onward = -1;
+  if (ghosts.mode[i] == FRIGHTENED || !navigation->junctions.SameCorridor(ghostCurrenTile, targetTile))
+    onward = navigation->junctions.Onward(ghostCurrenTile, ghosts.direction[i]);
+  if (onward >= 0)
+  {
+    ghosts.direction[i] = glm::vec2(navigationDirs[onward]);
+  }
+  else if (ghosts.mode[i] == FRIGHTENED)
+  {
+    std::vector<glm::ivec2> possibleDirs;
+    for (auto d : dirs)
+    {
+      glm::ivec2 next = ghostCurrenTile + d;
+      if (tiles.ghostCanEnter(next) && glm::vec2(d) != -ghosts.direction[i])
+      {
+        possibleDirs.push_back(d);
+      }
+    }
+    if (!possibleDirs.empty())
+    {
+      int r = rng.below((uint32_t)possibleDirs.size());
+      ghosts.direction[i] = glm::vec2(possibleDirs[r]);
+    }
+    else
+    {
+      ghosts.direction[i] = -ghosts.direction[i]; // reverse
+    }
+  }
+  else
+  {
+    ghosts.direction[i] = glm::vec2(navigation->NextStep(ghostCurrenTile, targetTile));
+  }
+}
+
+// cells and alignment come from the locate at the start of the tick; nothing
+// between it and here moves a ghost
+void Simulation::updateGhostPhysics(float deltaTime)
+{
+  PROFILE_ZONE("updateGhostPhysics");
+  // a zone per steer for the classic few; past that they would flood the
+  // profiler's ring and cost more than the steering itself
+  const bool zonePerSteer = ghosts.size() <= STEER_ZONE_MAX_GHOSTS;
+  {
+    PROFILE_ZONE("steerGhosts");
+    for (size_t i = 0; i < ghosts.size(); i++)
+    {
+      if (!ghosts.aligned[i])
+        continue;
+      if (zonePerSteer)
+      {
+        PROFILE_ZONE(ghostZoneNames[ghosts.type[i]]);
+        steerGhost(i);
+      }
+      else
+      {
+        steerGhost(i);
+      }
+    }
+  }
+  IntegrateGhosts(ghosts, 0, ghosts.size(), deltaTime);
+}
+
+void Simulation::PhysicsUpdate(float deltaTime, glm::vec2 &desiredDir)
+{
+  PROFILE_ZONE("PhysicsUpdate");
+  events = 0;
+  if (state == GAME_WIN)
+    return;
+  pacman.previousPosition = pacman.position;
+  ghosts.previousPosition = ghosts.position;
+  gameTime += deltaTime;
+  globalModeTimer += deltaTime;
+  locateGhosts();
+  auto pacmanTile = pxToCell(pacman.position);
+  for (size_t i = 0; i < ghosts.size(); i++)
+  {
+    ghosts.UpdateMode(i, globalModeTimer);
+    if (pacmanTile == ghosts.cell[i] && ghosts.mode[i] != EATEN)
+    {
+      if (ghosts.mode[i] == FRIGHTENED)
+      {
+        LOG_INFO("Pacman ate a ghost!");
+        ghosts.targetTile[i] = ghosts.housePosition[i];
+        ghosts.mode[i] = EATEN;
+        events |= EVENT_GHOST_EATEN;
+      }
+      else {
+        LOG_INFO("Ghost %c caught Pacman! Game Over!", ghosts.symbol[i]);
+        events |= EVENT_PACMAN_CAUGHT;
+        Reset(); // relocates the ghosts
+      }
+    }
+  }
+
+  updatePacmanPhysics(deltaTime, desiredDir);
+  updateGhostPhysics(deltaTime);
+}
+
+#endif
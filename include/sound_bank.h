@@ -0,0 +1,210 @@
+#ifndef SOUND_BANK_H
+#define SOUND_BANK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <semaphore.h>
+#include "miniaudio.h"
+#include "asset_pack.h"
+
+// Sound effects decoded once up front, each with a fixed pool of voices that
+// read the shared PCM in place. Play only pushes the effect id onto a
+// lock-free queue and posts a semaphore; a dispatcher thread pops it and
+// starts a voice, so the game thread never touches the disk, the decoder or
+// the allocator.
+struct SoundBank
+{
+  static constexpr uint32_t QUEUE_SIZE = 64;
+
+  SoundBank() {}
+  SoundBank(const SoundBank &) = delete;
+  SoundBank &operator=(const SoundBank &) = delete;
+  ~SoundBank() { Shutdown(); }
+
+  // decodes path (or reads its PCM from pack) and creates voices sounds for
+  // it; returns the effect id, or -1 if it can't be played. When every voice
+  // is busy a new Play restarts the oldest one if stealWhenBusy, otherwise
+  // it is dropped.
+  int Add(ma_engine *engine, const char *path, int voices, bool stealWhenBusy, const AssetPack *pack = nullptr);
+  // starts the dispatcher; call after the last Add
+  void Start();
+  void Shutdown();
+
+  // queues effect to play; wait-free, for a single producer thread
+  void Play(int effect);
+
+private:
+  struct Voice
+  {
+    ma_audio_buffer buffer;
+    ma_sound sound;
+    uint64_t startedAt = 0;
+  };
+  struct Effect
+  {
+    std::string path;
+    std::vector<float> decoded; // empty when the PCM lives in the asset pack
+    bool stealWhenBusy = false;
+    std::vector<std::unique_ptr<Voice>> voices;
+  };
+
+  std::vector<std::unique_ptr<Effect>> effects;
+  uint8_t queue[QUEUE_SIZE];
+  std::atomic<uint32_t> head{0}; // written by Play
+  std::atomic<uint32_t> tail{0}; // written by the dispatcher
+  std::atomic<bool> stopping{false};
+  sem_t ready;
+  bool started = false;
+  std::thread dispatcher;
+  uint64_t playCount = 0;
+
+  void dispatch();
+  void startVoice(Effect &effect);
+};
+
+int SoundBank::Add(ma_engine *engine, const char *path, int voices, bool stealWhenBusy, const AssetPack *pack)
+{
+  if (!engine || voices < 1 || effects.size() >= 255)
+    return -1;
+  std::unique_ptr<Effect> effect(new Effect());
+  effect->path = path;
+  effect->stealWhenBusy = stealWhenBusy;
+
+  const void *pcm = nullptr;
+  ma_uint32 channels = 0, sampleRate = 0;
+  ma_uint64 frameCount = 0;
+  const AssetPackEntry *entry = pack ? pack->Find(path, ASSET_SOUND) : nullptr;
+  if (entry && entry->size == entry->frameCount * entry->channels * sizeof(float))
+  {
+    pcm = pack->Data(*entry);
+    channels = entry->channels;
+    sampleRate = entry->sampleRate;
+    frameCount = entry->frameCount;
+  }
+  else
+  {
+    // decode straight to the engine's format so playback needs no conversion
+    ma_decoder_config config = ma_decoder_config_init(ma_format_f32, ma_engine_get_channels(engine), ma_engine_get_sample_rate(engine));
+    void *frames = NULL;
+    ma_result result = ma_decode_file(path, &config, &frameCount, &frames);
+    if (result != MA_SUCCESS)
+    {
+      printf("Failed to decode sound %s: %d\n", path, result);
+      return -1;
+    }
+    channels = config.channels;
+    sampleRate = config.sampleRate;
+    effect->decoded.assign((float *)frames, (float *)frames + frameCount * channels);
+    ma_free(frames, NULL);
+    pcm = effect->decoded.data();
+  }
+
+  for (int i = 0; i < voices; i++)
+  {
+    std::unique_ptr<Voice> voice(new Voice());
+    ma_audio_buffer_config config = ma_audio_buffer_config_init(ma_format_f32, channels, frameCount, pcm, NULL);
+    config.sampleRate = sampleRate;
+    if (ma_audio_buffer_init(&config, &voice->buffer) != MA_SUCCESS)
+      break;
+    if (ma_sound_init_from_data_source(engine, &voice->buffer, 0, NULL, &voice->sound) != MA_SUCCESS)
+    {
+      ma_audio_buffer_uninit(&voice->buffer);
+      break;
+    }
+    effect->voices.push_back(std::move(voice));
+  }
+  if (effect->voices.empty())
+  {
+    printf("Failed to create voices for sound %s\n", path);
+    return -1;
+  }
+  effects.push_back(std::move(effect));
+  return (int)effects.size() - 1;
+}
+
+void SoundBank::Start()
+{
+  if (started)
+    return;
+  sem_init(&ready, 0, 0);
+  stopping = false;
+  started = true;
+  dispatcher = std::thread(&SoundBank::dispatch, this);
+}
+
+void SoundBank::Shutdown()
+{
+  if (started)
+  {
+    stopping = true;
+    sem_post(&ready);
+    dispatcher.join();
+    sem_destroy(&ready);
+    started = false;
+  }
+  for (auto &effect : effects)
+  {
+    for (auto &voice : effect->voices)
+    {
+      ma_sound_uninit(&voice->sound);
+      ma_audio_buffer_uninit(&voice->buffer);
+    }
+  }
+  effects.clear();
+}
+
+void SoundBank::Play(int effect)
+{
+  if (effect < 0 || !started)
+    return;
+  uint32_t h = head.load(std::memory_order_relaxed);
+  if (h - tail.load(std::memory_order_acquire) == QUEUE_SIZE)
+    return; // a backlog this deep is inaudible anyway
+  queue[h % QUEUE_SIZE] = (uint8_t)effect;
+  head.store(h + 1, std::memory_order_release);
+  sem_post(&ready);
+}
+
+void SoundBank::dispatch()
+{
+  while (true)
+  {
+    while (sem_wait(&ready) != 0)
+      ;
+    if (stopping)
+      return;
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    for (; t != h; t++)
+      startVoice(*effects[queue[t % QUEUE_SIZE]]);
+    tail.store(t, std::memory_order_release);
+  }
+}
+
+// a free voice if there is one, else the oldest if the effect may steal
+void SoundBank::startVoice(Effect &effect)
+{
+  Voice *chosen = nullptr;
+  for (auto &voice : effect.voices)
+  {
+    if (!ma_sound_is_playing(&voice->sound))
+    {
+      chosen = voice.get();
+      break;
+    }
+    if (effect.stealWhenBusy && (!chosen || voice->startedAt < chosen->startedAt))
+      chosen = voice.get();
+  }
+  if (!chosen)
+    return;
+  ma_sound_seek_to_pcm_frame(&chosen->sound, 0);
+  ma_sound_start(&chosen->sound);
+  chosen->startedAt = ++playCount;
+}
+
+#endif
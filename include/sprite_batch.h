@@ -0,0 +1,83 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <glad/glad.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+// per-instance data read by shaders/sprite.vs at attribute location 2
+struct SpriteInstance
+{
+  glm::vec2 offset; // center in pixels
+  float scale;      // quad size in pixels
+  float layer;      // texture layer
+};
+
+// Collects sprite instances on the CPU and draws ranges of them with
+// instanced calls over the shared unit quad.
+struct SpriteBatch
+{
+  unsigned int instanceVBO = 0;
+  size_t capacity = 0;
+  std::vector<SpriteInstance> instances;
+
+  // attaches the instance buffer to the quad VAO
+  void Init(unsigned int VAO)
+  {
+    glGenBuffers(1, &instanceVBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)0); // aInstance
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+  }
+
+  void Begin()
+  {
+    instances.clear();
+  }
+
+  int Add(glm::vec2 offset, float scale, float layer = 0.0f)
+  {
+    instances.push_back({offset, scale, layer});
+    return (int)instances.size() - 1;
+  }
+
+  // uploads instances [first, end) in one call; the storage only grows, and
+  // growing re-uploads everything
+  void Upload(int first = 0)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (instances.size() > capacity)
+    {
+      capacity = instances.size();
+      glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(SpriteInstance), instances.data(), GL_DYNAMIC_DRAW);
+    }
+    else if ((size_t)first < instances.size())
+    {
+      glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(SpriteInstance), (instances.size() - first) * sizeof(SpriteInstance), &instances[first]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  // re-uploads the single instance at index after it was edited in place
+  void Patch(int index)
+  {
+    if ((size_t)index >= capacity)
+      return;
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, index * sizeof(SpriteInstance), sizeof(SpriteInstance), &instances[index]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  // expects the quad VAO bound
+  void Draw(int first, int count)
+  {
+    if (count > 0)
+      glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, count, first);
+  }
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SPRITE_SCENE_H
+#define SPRITE_SCENE_H
+
+#include <vector>
+#include "simulation.h"
+#include "sprite_batch.h"
+
+// texture layer of every sprite the game draws
+struct SpriteLayers
+{
+  int wall = 0;
+  int pellet = 0;
+  int apple = 0;
+  int strawberry = 0;
+  int frightened = 0;
+  int ghosts[4] = {};
+  // pacman animation frames: right, left, down, up
+  int pacman[4][3] = {};
+};
+
+// The CPU side of a frame: the sprite instances for a simulation, without
+// any GL calls, so it also runs (and is benchmarked) with no context.
+
+// walls, then pellets and fruit; itemInstances gets, per cell, the instance
+// drawing its item or -1
+void AddBoardSprites(SpriteBatch &batch, const Simulation &sim, const SpriteLayers &layers, std::vector<int> &itemInstances)
+{
+  const TileGrid &tiles = sim.tiles;
+  for (int y = 0; y < tiles.height; y++)
+    for (int x = 0; x < tiles.width; x++)
+      if (tiles.cells[y * tiles.width + x] & TILE_WALL)
+        batch.Add(sim.cellToPx(glm::ivec2(x, y)), sim.tileSize, layers.wall);
+
+  itemInstances.assign(tiles.cellCount(), -1);
+  for (int y = 0; y < tiles.height; y++)
+  {
+    for (int x = 0; x < tiles.width; x++)
+    {
+      int i = y * tiles.width + x;
+      uint8_t cell = tiles.cells[i];
+      glm::vec2 cellPx = sim.cellToPx(glm::ivec2(x, y));
+      if (cell & TILE_WALL)
+        continue;
+      else if (cell & TILE_PELLET)
+        itemInstances[i] = batch.Add(cellPx, sim.tileSize, layers.pellet);
+      else if (cell & TILE_POWER_PELLET) // big pellet
+        itemInstances[i] = batch.Add(cellPx, sim.tileSize * 3.0f, layers.pellet);
+      else if (cell & TILE_FRUIT)
+        itemInstances[i] = batch.Add(cellPx, sim.tileSize, layers.apple);
+    }
+  }
+}
+
+// pacman and the ghosts, alpha of the way from their previous positions
+void AddActorSprites(SpriteBatch &batch, const Simulation &sim, const SpriteLayers &layers, float alpha)
+{
+  const Pacman &pacman = sim.pacman;
+  int facing = pacman.facing.x > 0 ? 0 : pacman.facing.x < 0 ? 1 : pacman.facing.y > 0 ? 2 : 3;
+  batch.Add(glm::mix(pacman.previousPosition, pacman.position, alpha), sim.tileSize, layers.pacman[facing][pacman.frame]);
+  const GhostArrays &ghosts = sim.ghosts;
+  for (size_t i = 0; i < ghosts.size(); i++)
+  {
+    batch.Add(glm::mix(ghosts.previousPosition[i], ghosts.position[i], alpha), sim.tileSize, ghosts.mode[i] == FRIGHTENED ? layers.frightened : layers.ghosts[ghosts.type[i]]);
+  }
+}
+
+#endif
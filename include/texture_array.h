@@ -0,0 +1,103 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <stdio.h>
+#include "utils.h"
+#include "thread_pool.h"
+#include "asset_pack.h"
+
+// Packs every sprite into the layers of one GL_TEXTURE_2D_ARRAY so a frame
+// binds a single texture. Sprites are resampled to a common square layer size.
+// Decoding runs on a thread pool, straight into one staging buffer that
+// Upload sends to GL in a single call. Layers found in an asset pack skip the
+// decode and upload straight from the pack's mapping.
+struct TextureArray
+{
+  unsigned int ID = 0;
+  int layerSize = 64;
+  std::vector<std::string> paths;
+  std::map<std::string, int> layers;
+  std::vector<unsigned char> staging;        // every decoded layer's RGBA pixels, back to back
+  std::vector<const unsigned char *> packed; // per layer, its pixels in the asset pack or null
+
+  // returns the layer the image at path will occupy; repeated paths share one
+  int Add(const std::string &path)
+  {
+    auto it = layers.find(path);
+    if (it != layers.end())
+      return it->second;
+    int layer = (int)paths.size();
+    paths.push_back(path);
+    layers[path] = layer;
+    return layer;
+  }
+
+  // queues one decode task per layer missing from pack on pool and returns
+  // without waiting, so the caller can do other startup work; no GL calls,
+  // any thread may run it
+  void Decode(ThreadPool &pool, const AssetPack *pack = nullptr)
+  {
+    size_t layerBytes = (size_t)layerSize * layerSize * 4;
+    staging.assign(layerBytes * paths.size(), 0);
+    packed.assign(paths.size(), nullptr);
+    for (int layer = 0; layer < (int)paths.size(); layer++)
+    {
+      const AssetPackEntry *entry = pack ? pack->Find(paths[layer].c_str(), ASSET_TEXTURE) : nullptr;
+      if (entry && (int)entry->width == layerSize && (int)entry->height == layerSize && entry->size == layerBytes)
+      {
+        packed[layer] = (const unsigned char *)pack->Data(*entry);
+        continue;
+      }
+      pool.Submit([this, layer, layerBytes]
+                  {
+        int width, height, nrChannels;
+        unsigned char *data = stbi_load(paths[layer].c_str(), &width, &height, &nrChannels, 4);
+        if (!data)
+        {
+          // the layer stays transparent
+          fprintf(stderr, "Failed to load texture: %s\n", paths[layer].c_str());
+          return;
+        }
+        resampleRGBA(data, width, height, &staging[layerBytes * layer], layerSize);
+        stbi_image_free(data); });
+    }
+  }
+
+  // creates the texture from the staging buffer in one upload, or one upload
+  // per layer when some come from a pack; the decode tasks must have finished
+  void Upload()
+  {
+    glGenTextures(1, &ID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, layerSize, layerSize, (int)paths.size());
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (std::count(packed.begin(), packed.end(), nullptr) == (long)paths.size())
+    {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, layerSize, layerSize, (int)paths.size(), GL_RGBA, GL_UNSIGNED_BYTE, staging.data());
+    }
+    else
+    {
+      size_t layerBytes = (size_t)layerSize * layerSize * 4;
+      for (int layer = 0; layer < (int)paths.size(); layer++)
+      {
+        const unsigned char *pixels = packed[layer] ? packed[layer] : &staging[layerBytes * layer];
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, layerSize, layerSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+      }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    std::vector<unsigned char>().swap(staging);
+    packed.clear();
+  }
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+// Fixed set of workers, each with its own task deque. A worker takes its
+// newest task first and, when it runs dry, steals the oldest task from
+// another worker, so shards that finish early (boards that hit Reset) pick up
+// work from the slow ones instead of idling.
+struct ThreadPool
+{
+  struct WorkerStats
+  {
+    double busySeconds = 0.0; // CPU time spent running tasks, not time descheduled
+    long tasks = 0;
+    long steals = 0;
+  };
+
+  explicit ThreadPool(int numWorkers = 0);
+  ~ThreadPool();
+
+  int size() const { return (int)workers.size(); }
+
+  void Submit(std::function<void()> task);
+  void Wait();
+  // runs fn(first, last) over [0, count) in chunks of at most grain, and blocks until all are done
+  void ParallelFor(int count, int grain, const std::function<void(int, int)> &fn);
+
+  std::vector<WorkerStats> Stats() const;
+  void ResetStats();
+  void PrintUtilization(FILE *out) const;
+
+private:
+  struct Worker
+  {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+    std::atomic<long> busyNanos{0};
+    std::atomic<long> taskCount{0};
+    std::atomic<long> stealCount{0};
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  std::atomic<unsigned int> nextWorker{0};
+  std::atomic<long> pending{0};
+  std::atomic<bool> stopping{false};
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::chrono::steady_clock::time_point statsStart;
+
+  static long threadCpuNanos();
+  bool popTask(int self, std::function<void()> &task);
+  void run(int self);
+};
+
+ThreadPool::ThreadPool(int numWorkers)
+{
+  if (numWorkers <= 0)
+    numWorkers = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 0; i < numWorkers; i++)
+    workers.emplace_back(new Worker());
+  statsStart = std::chrono::steady_clock::now();
+  for (int i = 0; i < numWorkers; i++)
+    threads.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &thread : threads)
+    thread.join();
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+  pending++;
+  Worker &worker = *workers[nextWorker++ % workers.size()];
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+  // taking the lock orders the push before a sleeping worker rechecks
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+  }
+  wake.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+  std::unique_lock<std::mutex> lock(wakeMutex);
+  idle.wait(lock, [this]
+            { return pending == 0; });
+}
+
+void ThreadPool::ParallelFor(int count, int grain, const std::function<void(int, int)> &fn)
+{
+  if (grain < 1)
+    grain = 1;
+  for (int first = 0; first < count; first += grain)
+  {
+    int last = std::min(count, first + grain);
+    Submit([&fn, first, last]
+           { fn(first, last); });
+  }
+  Wait();
+}
+
+// CPU time of the calling thread, so a worker that is runnable but not
+// running (more workers than cores) doesn't count as busy
+long ThreadPool::threadCpuNanos()
+{
+  timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+bool ThreadPool::popTask(int self, std::function<void()> &task)
+{
+  {
+    Worker &own = *workers[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty())
+    {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < workers.size(); i++)
+  {
+    Worker &victim = *workers[(self + i) % workers.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty())
+    {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      workers[self]->stealCount++;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run(int self)
+{
+  Worker &worker = *workers[self];
+  std::function<void()> task;
+  while (true)
+  {
+    if (popTask(self, task))
+    {
+      long start = threadCpuNanos();
+      task();
+      task = nullptr;
+      worker.busyNanos += threadCpuNanos() - start;
+      worker.taskCount++;
+      if (--pending == 0)
+      {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        idle.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    if (stopping)
+      return;
+    // recheck under the lock so a Submit between the scan and the wait isn't missed
+    bool queued = false;
+    for (auto &w : workers)
+    {
+      std::lock_guard<std::mutex> taskLock(w->mutex);
+      queued = queued || !w->tasks.empty();
+    }
+    if (!queued)
+      wake.wait(lock);
+  }
+}
+
+std::vector<ThreadPool::WorkerStats> ThreadPool::Stats() const
+{
+  std::vector<WorkerStats> stats(workers.size());
+  for (size_t i = 0; i < workers.size(); i++)
+  {
+    stats[i].busySeconds = workers[i]->busyNanos * 1e-9;
+    stats[i].tasks = workers[i]->taskCount;
+    stats[i].steals = workers[i]->stealCount;
+  }
+  return stats;
+}
+
+void ThreadPool::ResetStats()
+{
+  for (auto &worker : workers)
+  {
+    worker->busyNanos = 0;
+    worker->taskCount = 0;
+    worker->stealCount = 0;
+  }
+  statsStart = std::chrono::steady_clock::now();
+}
+
+// CPU time each worker spent on tasks as a share of the wall time since the last ResetStats
+void ThreadPool::PrintUtilization(FILE *out) const
+{
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStart).count();
+  auto stats = Stats();
+  for (size_t i = 0; i < stats.size(); i++)
+  {
+    fprintf(out, "worker %2zu: %5.1f%% busy, %ld tasks, %ld stolen\n",
+            i, wall > 0.0 ? 100.0 * stats[i].busySeconds / wall : 0.0, stats[i].tasks, stats[i].steals);
+  }
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef TILE_GRID_H
+#define TILE_GRID_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+// one byte per cell: what the tile holds plus precomputed walkability
+enum TileFlag : uint8_t
+{
+  TILE_WALL = 1 << 0,
+  TILE_DOOR = 1 << 1, // ghost house door, ghosts only
+  TILE_PELLET = 1 << 2,
+  TILE_POWER_PELLET = 1 << 3,
+  TILE_FRUIT = 1 << 4,
+  TILE_GHOST_HOUSE = 1 << 5,
+  TILE_PACMAN_WALKABLE = 1 << 6,
+  TILE_GHOST_WALKABLE = 1 << 7
+};
+
+// The maze as one contiguous row-major array of TileFlag bytes. Loaded from
+// the character layout used by Reset:
+//   '#' wall, '-' door, '.' pellet, '*' power pellet, 'A' fruit,
+//   'B' 'P' 'I' 'C' ghost spawns (inside the ghost house), anything else is open floor.
+struct TileGrid
+{
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> cells;
+
+  void Load(const std::vector<std::string> &rows);
+
+  int cellCount() const { return width * height; }
+  bool inBounds(glm::ivec2 cell) const
+  {
+    return cell.x >= 0 && cell.y >= 0 && cell.x < width && cell.y < height;
+  }
+  int cellIndex(glm::ivec2 cell) const { return cell.y * width + cell.x; }
+
+  // anything outside the grid reads as solid wall
+  uint8_t at(glm::ivec2 cell) const
+  {
+    return inBounds(cell) ? cells[cellIndex(cell)] : (uint8_t)TILE_WALL;
+  }
+  bool pacmanCanEnter(glm::ivec2 cell) const { return at(cell) & TILE_PACMAN_WALKABLE; }
+  bool ghostCanEnter(glm::ivec2 cell) const { return at(cell) & TILE_GHOST_WALKABLE; }
+
+  void clear(glm::ivec2 cell, uint8_t flags)
+  {
+    if (inBounds(cell))
+      cells[cellIndex(cell)] &= ~flags;
+  }
+};
+
+bool isGhostSpawnSymbol(char tile)
+{
+  return tile == 'B' || tile == 'P' || tile == 'I' || tile == 'C';
+}
+
+void TileGrid::Load(const std::vector<std::string> &rows)
+{
+  height = (int)rows.size();
+  width = 0;
+  for (auto &row : rows)
+    width = std::max(width, (int)row.length());
+
+  cells.assign(cellCount(), 0);
+  for (int y = 0; y < height; y++)
+  {
+    for (int x = 0; x < (int)rows[y].length(); x++)
+    {
+      uint8_t cell = 0;
+      switch (rows[y][x])
+      {
+      case '#':
+        cell = TILE_WALL;
+        break;
+      case '-':
+        cell = TILE_DOOR;
+        break;
+      case '.':
+        cell = TILE_PELLET;
+        break;
+      case '*':
+        cell = TILE_POWER_PELLET;
+        break;
+      case 'A':
+        cell = TILE_FRUIT;
+        break;
+      }
+      if (!(cell & TILE_WALL))
+        cell |= TILE_GHOST_WALKABLE;
+      if (!(cell & (TILE_WALL | TILE_DOOR)))
+        cell |= TILE_PACMAN_WALKABLE;
+      cells[y * width + x] = cell;
+    }
+  }
+
+  // the ghost house is the open area around the spawns, bounded by walls and the door
+  std::vector<glm::ivec2> stack;
+  for (int y = 0; y < height; y++)
+    for (int x = 0; x < (int)rows[y].length(); x++)
+      if (isGhostSpawnSymbol(rows[y][x]))
+        stack.push_back({x, y});
+  static const glm::ivec2 dirs[] = {
+      {1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+  while (!stack.empty())
+  {
+    glm::ivec2 cur = stack.back();
+    stack.pop_back();
+    uint8_t &cell = cells[cellIndex(cur)];
+    if (cell & TILE_GHOST_HOUSE)
+      continue;
+    cell |= TILE_GHOST_HOUSE;
+    for (auto d : dirs)
+    {
+      glm::ivec2 next = cur + d;
+      if (inBounds(next) && !(at(next) & (TILE_WALL | TILE_DOOR | TILE_GHOST_HOUSE)))
+        stack.push_back(next);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// binding points shared by the C++ side and the shaders' layout(binding = N)
+enum UniformBinding
+{
+  FRAME_CONSTANTS_BINDING = 0
+};
+
+// matches the std140 FrameConstants block in shaders/sprite.vs
+struct FrameConstants
+{
+  glm::mat4 projection;
+  glm::mat4 view;
+};
+
+// One uniform buffer holding a T, bound to a fixed binding point so every
+// program that declares the block reads it without per-program uniform calls.
+// T must already have std140 layout.
+template <typename T>
+struct UniformBuffer
+{
+  unsigned int ID = 0;
+  unsigned int binding = 0;
+
+  void Init(unsigned int bindingPoint)
+  {
+    binding = bindingPoint;
+    glGenBuffers(1, &ID);
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+  }
+
+  void Update(const T &value)
+  {
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &value);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+};
+
+#endif
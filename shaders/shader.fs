@@ -1,11 +0,0 @@
-#version 460 core
-out vec4 FragColor;
-
-in vec2 ourTexCoord;
-
-uniform sampler2D texture1;
-
-void main()
-{
-    FragColor = texture(texture1, ourTexCoord);
-}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 460 core
+out vec4 FragColor;
+
+in vec2 ourTexCoord;
+flat in float ourLayer;
+flat in ivec2 ourItemCell;
+
+uniform sampler2DArray sprites;
+uniform sampler2D itemVisibility; // one R8 texel per board cell, 0 once its item is eaten
+
+void main()
+{
+    if (ourItemCell.x >= 0 && texelFetch(itemVisibility, ourItemCell, 0).r == 0.0)
+        discard;
+    FragColor = texture(sprites, vec3(ourTexCoord, ourLayer));
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aInstance; // xy offset, z scale, w texture layer
+
+out vec2 ourTexCoord;
+flat out float ourLayer;
+flat out ivec2 ourItemCell; // board cell checked against itemVisibility, (-1, -1) to always draw
+
+// updated once per frame, see FrameConstants in include/uniform_buffer.h
+layout (std140, binding = 0) uniform FrameConstants
+{
+    mat4 projection;
+    mat4 view;
+};
+
+// with BOARD_VISIBILITY_TEXTURE, instances [itemFirst, itemEnd) are the
+// board's pellets and fruit; otherwise itemEnd is 0
+uniform int itemFirst;
+uniform int itemEnd;
+uniform vec2 boardOrigin; // center of cell (0, 0) in pixels
+uniform float boardTileSize;
+
+void main()
+{
+    gl_Position = projection * view * vec4(aPos.xy * aInstance.z + aInstance.xy, aPos.z, 1.0);
+    ourTexCoord = aTexCoord;
+    ourLayer = aInstance.w;
+    int instance = gl_BaseInstance + gl_InstanceID;
+    if (instance >= itemFirst && instance < itemEnd)
+        ourItemCell = ivec2(round((aInstance.xy - boardOrigin) / boardTileSize));
+    else
+        ourItemCell = ivec2(-1);
+}
\ No newline at end of file
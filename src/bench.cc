@@ -0,0 +1,452 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "simulation.h"
+#include "sprite_scene.h"
+
+// Microbenchmarks for the per-tick and per-frame hot paths: navigation,
+// ghost and pacman physics, whole ticks at several ghost counts, the pixel
+// and cell conversions and the CPU side of Draw. No window or GL context is
+// needed; Draw is measured up to the point its instances would be uploaded.
+//
+//   build/bench [--reps N] [--min-time S] [--filter TEXT] [--json FILE]
+//
+// Each benchmark is warmed up, then its iteration count is doubled until one
+// repetition takes --min-time seconds (default 0.01), and --reps repetitions
+// (default 15) are timed. The table goes to stderr, game chatter to stdout,
+// so run it as `build/bench > /dev/null`. --json writes the same numbers in
+// nanoseconds per operation, for comparing runs with a script.
+
+// keeps the compiler from dropping a result nothing else reads
+template <typename T>
+static inline void doNotOptimize(const T &value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// exposes the per-actor steps PhysicsUpdate is made of
+struct BenchSimulation : Simulation
+{
+  using Simulation::Simulation;
+  using Simulation::steerGhost;
+  using Simulation::updatePacmanPhysics;
+
+  // one ghost's share of a tick: locate, steer at a cell center, move
+  void UpdateGhost(size_t i, float deltaTime)
+  {
+    LocateGhosts(ghosts, i, i + 1, glm::vec2(startX, startY), tileSize);
+    if (ghosts.aligned[i])
+      steerGhost(i);
+    IntegrateGhosts(ghosts, i, i + 1, deltaTime);
+  }
+
+  // the four ghosts repeated up to count; the copies share their originals'
+  // spawn cells
+  void SetGhostCount(int count)
+  {
+    roster = ghostRoster(count);
+    Reset();
+  }
+};
+
+struct Benchmark
+{
+  std::string name;
+  std::function<void(long)> run; // runs the operation n times
+};
+
+struct BenchResult
+{
+  std::string name;
+  long iterations = 0; // per repetition
+  double min = 0, median = 0, mean = 0, p95 = 0, stddev = 0; // ns per operation
+};
+
+static double timeRun(const Benchmark &bench, long iterations)
+{
+  auto start = std::chrono::steady_clock::now();
+  bench.run(iterations);
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static BenchResult measure(const Benchmark &bench, int reps, double minTime)
+{
+  // warm caches, branch predictors and the CPU clock, and find an
+  // iteration count that makes timer overhead negligible
+  long iterations = 1;
+  double seconds = timeRun(bench, iterations);
+  while (seconds < minTime && iterations < (1L << 40))
+  {
+    iterations *= 2;
+    seconds = timeRun(bench, iterations);
+  }
+
+  std::vector<double> samples;
+  for (int r = 0; r < reps; r++)
+    samples.push_back(timeRun(bench, iterations) * 1e9 / iterations);
+  std::sort(samples.begin(), samples.end());
+
+  BenchResult result;
+  result.name = bench.name;
+  result.iterations = iterations;
+  result.min = samples.front();
+  result.median = samples[samples.size() / 2];
+  result.p95 = samples[std::min(samples.size() - 1, (size_t)std::ceil(samples.size() * 0.95) - 1)];
+  for (double s : samples)
+    result.mean += s;
+  result.mean /= samples.size();
+  for (double s : samples)
+    result.stddev += (s - result.mean) * (s - result.mean);
+  result.stddev = std::sqrt(result.stddev / samples.size());
+  return result;
+}
+
+// source/target pairs of walkable cells whose path length falls in [minSteps, maxSteps]
+static std::vector<std::pair<glm::ivec2, glm::ivec2>> navigationPairs(const NavigationTable &table, const TileGrid &tiles,
+                                                                      int minSteps, int maxSteps)
+{
+  std::vector<glm::ivec2> walkable;
+  for (int y = 0; y < tiles.height; y++)
+    for (int x = 0; x < tiles.width; x++)
+      if (tiles.ghostCanEnter(glm::ivec2(x, y)))
+        walkable.push_back(glm::ivec2(x, y));
+
+  std::vector<std::pair<glm::ivec2, glm::ivec2>> pairs;
+  for (glm::ivec2 from : walkable)
+  {
+    for (glm::ivec2 to : walkable)
+    {
+      int steps = 0;
+      glm::ivec2 cell = from;
+      while (cell != to && steps <= maxSteps)
+      {
+        glm::ivec2 step = table.NextStep(cell, to);
+        if (step == glm::ivec2(0, 0))
+          break;
+        cell += step;
+        steps++;
+      }
+      if (cell == to && steps >= minSteps && steps <= maxSteps)
+        pairs.push_back({from, to});
+    }
+  }
+  // visit them in random order so the table lookups don't stream
+  Rng rng(7);
+  for (size_t i = pairs.size(); i > 1; i--)
+    std::swap(pairs[i - 1], pairs[rng.below((uint32_t)i)]);
+  return pairs;
+}
+
+static void writeJson(const char *path, const std::vector<BenchResult> &results, int reps, double minTime)
+{
+  FILE *file = fopen(path, "w");
+  if (!file)
+  {
+    fprintf(stderr, "failed to open %s\n", path);
+    return;
+  }
+  fprintf(file, "{\"reps\":%d,\"min_time_s\":%g,\"unit\":\"ns/op\",\"benchmarks\":[\n", reps, minTime);
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const BenchResult &r = results[i];
+    fprintf(file, "{\"name\":\"%s\",\"iterations\":%ld,\"min\":%.3f,\"median\":%.3f,\"mean\":%.3f,\"p95\":%.3f,\"stddev\":%.3f}%s\n",
+            r.name.c_str(), r.iterations, r.min, r.median, r.mean, r.p95, r.stddev, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(file, "]}\n");
+  fclose(file);
+}
+
+int main(int argc, char **argv)
+{
+  int reps = 15;
+  double minTime = 0.01;
+  const char *filter = nullptr;
+  const char *jsonPath = nullptr;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    if (!strcmp(argv[i], "--reps"))
+      reps = std::max(1, atoi(argv[i + 1]));
+    else if (!strcmp(argv[i], "--min-time"))
+      minTime = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--filter"))
+      filter = argv[i + 1];
+    else if (!strcmp(argv[i], "--json"))
+      jsonPath = argv[i + 1];
+    else
+    {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  const float deltaTime = 1.0f / 120.0f;
+  std::vector<Benchmark> benches;
+
+  // navigation
+  BenchSimulation base;
+  benches.push_back({"navigation/build", [&](long n)
+                     {
+                       for (long i = 0; i < n; i++)
+                       {
+                         NavigationTable table;
+                         table.Build(base.tiles, TILE_GHOST_WALKABLE);
+                         doNotOptimize(table.nextHop.data());
+                       }
+                     }});
+  benches.push_back({"navigation/junction_graph", [&](long n)
+                     {
+                       for (long i = 0; i < n; i++)
+                       {
+                         JunctionGraph graph;
+                         graph.Build(base.tiles, TILE_GHOST_WALKABLE);
+                         doNotOptimize(graph.edges.data());
+                       }
+                     }});
+  struct DistanceBucket
+  {
+    const char *name;
+    int minSteps, maxSteps;
+  };
+  static const DistanceBucket buckets[] = {{"near", 1, 4}, {"mid", 5, 20}, {"far", 21, 1 << 30}};
+  std::vector<std::vector<std::pair<glm::ivec2, glm::ivec2>>> pairSets;
+  for (const DistanceBucket &bucket : buckets)
+    pairSets.push_back(navigationPairs(*base.navigation, base.tiles, bucket.minSteps, bucket.maxSteps));
+  for (size_t b = 0; b < pairSets.size(); b++)
+  {
+    if (pairSets[b].empty())
+      continue;
+    benches.push_back({std::string("navigation/next_step/") + buckets[b].name, [&, b](long n)
+                       {
+                         const NavigationTable &table = *base.navigation;
+                         const auto &pairs = pairSets[b];
+                         size_t p = 0;
+                         for (long i = 0; i < n; i++)
+                         {
+                           doNotOptimize(table.NextStep(pairs[p].first, pairs[p].second));
+                           p = p + 1 == pairs.size() ? 0 : p + 1;
+                         }
+                       }});
+  }
+
+  // the lazy mode: a handful of hot targets stay cached, a stream of new
+  // ones builds a field per lookup
+  NavigationTable flowFields;
+  flowFields.Build(base.tiles, TILE_GHOST_WALKABLE, NAVIGATION_FLOW_FIELDS, 8);
+  const auto &farPairs = pairSets.back();
+  // lookups each made and fields they built, for the hit rates under the table
+  struct FieldCounts
+  {
+    const char *name;
+    long lookups;
+    uint64_t built;
+  };
+  FieldCounts fieldCounts[] = {{"navigation/flow_fields/hit", 0, 0}, {"navigation/flow_fields/miss", 0, 0}};
+  benches.push_back({fieldCounts[0].name, [&](long n)
+                     {
+                       uint64_t built = flowFields.fieldsBuilt();
+                       size_t p = 0;
+                       for (long i = 0; i < n; i++)
+                       {
+                         doNotOptimize(flowFields.NextStep(farPairs[p].first, farPairs[p % 4].second));
+                         p = p + 1 == farPairs.size() ? 0 : p + 1;
+                       }
+                       fieldCounts[0].lookups += n;
+                       fieldCounts[0].built += flowFields.fieldsBuilt() - built;
+                     }});
+  benches.push_back({fieldCounts[1].name, [&](long n)
+                     {
+                       uint64_t built = flowFields.fieldsBuilt();
+                       size_t p = 0;
+                       for (long i = 0; i < n; i++)
+                       {
+                         doNotOptimize(flowFields.NextStep(farPairs[p].first, farPairs[p].second));
+                         p = p + 1 == farPairs.size() ? 0 : p + 1;
+                       }
+                       fieldCounts[1].lookups += n;
+                       fieldCounts[1].built += flowFields.fieldsBuilt() - built;
+                     }});
+
+  // one ghost at a time, chasing a pacman parked mid-maze
+  static const char *ghostNames[] = {"blinky", "pinky", "inky", "clyde"};
+  BenchSimulation ghostSim;
+  ghostSim.state = GAME_ACTIVE;
+  ghostSim.pacman.direction = glm::vec2(1.0f, 0.0f);
+  for (int type = BLINKY; type <= CLYDE; type++)
+  {
+    benches.push_back({std::string("physics/ghost/") + ghostNames[type], [&ghostSim, type, deltaTime](long n)
+                       {
+                         ghostSim.ghosts.mode[type] = CHASE;
+                         for (long i = 0; i < n; i++)
+                           ghostSim.UpdateGhost(type, deltaTime);
+                         doNotOptimize(ghostSim.ghosts.position[type]);
+                       }});
+  }
+
+  BenchSimulation pacmanSim;
+  pacmanSim.state = GAME_ACTIVE;
+  benches.push_back({"physics/pacman", [&](long n)
+                     {
+                       static const glm::vec2 inputs[] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+                       glm::vec2 desiredDir = inputs[0];
+                       for (long i = 0; i < n; i++)
+                       {
+                         if (i % 30 == 0)
+                           desiredDir = inputs[(i / 30) % 4];
+                         pacmanSim.updatePacmanPhysics(deltaTime, desiredDir);
+                         if (pacmanSim.state == GAME_WIN)
+                           pacmanSim.Reset();
+                       }
+                       doNotOptimize(pacmanSim.pacman.position);
+                     }});
+
+  // whole ticks, with steering changes a few times a second
+  static const int ghostCounts[] = {4, 64, 1024};
+  std::vector<std::unique_ptr<BenchSimulation>> tickSims;
+  for (int count : ghostCounts)
+  {
+    tickSims.emplace_back(new BenchSimulation(1));
+    BenchSimulation &sim = *tickSims.back();
+    sim.SetGhostCount(count);
+    benches.push_back({"tick/ghosts_" + std::to_string(count), [&sim, deltaTime](long n)
+                       {
+                         static const glm::vec2 inputs[] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+                         glm::vec2 desiredDir = inputs[0];
+                         for (long i = 0; i < n; i++)
+                         {
+                           if (i % 30 == 0)
+                             desiredDir = inputs[sim.rng.below(4)];
+                           sim.PhysicsUpdate(deltaTime, desiredDir);
+                           if (sim.state == GAME_WIN)
+                             sim.Reset();
+                         }
+                         doNotOptimize(sim.score);
+                       }});
+  }
+
+  // the movement kernels alone over the 1024 ghost board, SIMD against the
+  // scalar reference; each op is the whole board
+  GhostArrays &crowd = tickSims.back()->ghosts;
+  const glm::vec2 origin(base.startX, base.startY);
+  benches.push_back({"ghosts/locate_1024", [&](long n)
+                     {
+                       for (long i = 0; i < n; i++)
+                       {
+                         LocateGhosts(crowd, 0, crowd.size(), origin, base.tileSize);
+                         doNotOptimize(crowd.aligned.data());
+                       }
+                     }});
+  benches.push_back({"ghosts/locate_1024_scalar", [&](long n)
+                     {
+                       for (long i = 0; i < n; i++)
+                       {
+                         locateGhostsScalar(crowd, 0, crowd.size(), origin, base.tileSize);
+                         doNotOptimize(crowd.aligned.data());
+                       }
+                     }});
+  // alternating directions keep the crowd in place
+  benches.push_back({"ghosts/integrate_1024", [&](long n)
+                     {
+                       for (long i = 0; i < n; i++)
+                       {
+                         IntegrateGhosts(crowd, 0, crowd.size(), i & 1 ? deltaTime : -deltaTime);
+                         doNotOptimize(crowd.position.data());
+                       }
+                     }});
+  benches.push_back({"ghosts/integrate_1024_scalar", [&](long n)
+                     {
+                       for (long i = 0; i < n; i++)
+                       {
+                         integrateGhostsScalar(crowd, 0, crowd.size(), i & 1 ? deltaTime : -deltaTime);
+                         doNotOptimize(crowd.position.data());
+                       }
+                     }});
+
+  // coordinate conversions over every cell of the board
+  std::vector<glm::vec2> positions;
+  std::vector<glm::ivec2> cells;
+  for (int y = 0; y < base.tiles.height; y++)
+    for (int x = 0; x < base.tiles.width; x++)
+    {
+      cells.push_back(glm::ivec2(x, y));
+      positions.push_back(base.cellToPx(glm::ivec2(x, y)) + glm::vec2(3.0f, -5.0f));
+    }
+  benches.push_back({"coords/px_to_cell", [&](long n)
+                     {
+                       size_t c = 0;
+                       for (long i = 0; i < n; i++)
+                       {
+                         doNotOptimize(base.pxToCell(positions[c]));
+                         c = c + 1 == positions.size() ? 0 : c + 1;
+                       }
+                     }});
+  benches.push_back({"coords/cell_to_px", [&](long n)
+                     {
+                       size_t c = 0;
+                       for (long i = 0; i < n; i++)
+                       {
+                         doNotOptimize(base.cellToPx(cells[c]));
+                         c = c + 1 == cells.size() ? 0 : c + 1;
+                       }
+                     }});
+
+  // the instances Draw would upload: the board on a new level, the actors every frame
+  SpriteLayers layers;
+  SpriteBatch batch;
+  std::vector<int> itemInstances;
+  benches.push_back({"draw/board", [&](long n)
+                     {
+                       for (long i = 0; i < n; i++)
+                       {
+                         batch.Begin();
+                         AddBoardSprites(batch, base, layers, itemInstances);
+                         doNotOptimize(batch.instances.data());
+                       }
+                     }});
+  benches.push_back({"draw/actors", [&](long n)
+                     {
+                       AddBoardSprites(batch, base, layers, itemInstances);
+                       size_t boardInstances = batch.instances.size();
+                       for (long i = 0; i < n; i++)
+                       {
+                         batch.instances.resize(boardInstances);
+                         AddActorSprites(batch, base, layers, 0.5f);
+                         doNotOptimize(batch.instances.data());
+                       }
+                     }});
+  benches.push_back({"draw/actors_1024_ghosts", [&](long n)
+                     {
+                       BenchSimulation &sim = *tickSims.back();
+                       for (long i = 0; i < n; i++)
+                       {
+                         batch.Begin();
+                         AddActorSprites(batch, sim, layers, 0.5f);
+                         doNotOptimize(batch.instances.data());
+                       }
+                     }});
+
+  std::vector<BenchResult> results;
+  fprintf(stderr, "%-32s %12s %10s %10s %10s %10s %10s\n", "benchmark", "iterations", "min ns", "median ns", "mean ns", "p95 ns", "stddev");
+  for (const Benchmark &bench : benches)
+  {
+    if (filter && bench.name.find(filter) == std::string::npos)
+      continue;
+    BenchResult r = measure(bench, reps, minTime);
+    fprintf(stderr, "%-32s %12ld %10.1f %10.1f %10.1f %10.1f %10.1f\n", r.name.c_str(), r.iterations, r.min, r.median,
+            r.mean, r.p95, r.stddev);
+    results.push_back(r);
+  }
+  for (const FieldCounts &counts : fieldCounts)
+    if (counts.lookups)
+      fprintf(stderr, "%-32s %.2f%% of %ld lookups hit a cached field\n", counts.name,
+              100.0 * (counts.lookups - (long)counts.built) / counts.lookups, counts.lookups);
+  if (jsonPath)
+    writeJson(jsonPath, results, reps, minTime);
+  return 0;
+}
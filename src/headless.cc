@@ -0,0 +1,208 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include "simulation.h"
+#include "batch_env.h"
+#include "thread_pool.h"
+#include "input_journal.h"
+
+// Steps the simulation without a window, GL context or sound engine and
+// reports throughput. Game chatter goes to stdout, the report to stderr, so
+// run it as `build/headless > /dev/null` to time the simulation alone.
+//
+//   build/headless [--ticks N] [--tick-rate HZ] [--envs N] [--threads N] [--seed N] [--ghosts N] [--maze N]
+//   build/headless --replay JOURNAL
+//
+// With --envs the games are stepped through BatchEnv, one action per game
+// per step, and --ticks counts ticks per game. --threads shards the games
+// across a work-stealing pool (0 means one worker per core) and reports how
+// busy each worker was. --seed picks the scripted input and every game's
+// RNG, so the same seed reproduces the same run at any thread count.
+// --ghosts fills every game with N ghosts cycling through the four types,
+// stacked on the maze's markers; 0 spawns one per marker. --maze N plays on
+// N x N joined copies of the default maze, past the dense navigation table's
+// limit from N = 2 on.
+//
+// --replay runs a session recorded with PACMAN_RECORD as fast as it can and
+// checks it ends with the recorded score and state hash; it exits 2 if not.
+//
+// The profiler report goes to stderr as well; PACMAN_TRACE=path also writes
+// the zones as a Chrome trace.
+static int replay(const char *path)
+{
+  InputJournal journal;
+  if (!journal.Load(path))
+  {
+    fprintf(stderr, "failed to load input journal %s\n", path);
+    return 1;
+  }
+  const InputJournalHeader &header = journal.header;
+  float deltaTime = 1.0f / header.tickRate;
+  Simulation sim(header.seed);
+  glm::vec2 desiredDir(0.0f, 0.0f);
+  size_t next = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t tick = 0; tick < header.ticks; tick++)
+  {
+    for (; next < journal.events.size() && journal.events[next].tick == tick; next++)
+      desiredDir = glm::vec2(journal.events[next].dx, journal.events[next].dy);
+    sim.pacman.updateAnimation(deltaTime);
+    sim.PhysicsUpdate(deltaTime, desiredDir);
+    if (tick % 1024 == 1023)
+      Profiler::Get().Collect();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t hash = sim.StateHash();
+  bool match = sim.score == header.finalScore && hash == header.finalHash;
+  fprintf(stderr, "replayed %u ticks, %u inputs (%.1f Hz) in %.3f s, %.0f ticks per second\n",
+          header.ticks, header.eventCount, header.tickRate, seconds, header.ticks / seconds);
+  fprintf(stderr, "score %.1f (recorded %.1f), hash %016llx (recorded %016llx): %s\n", sim.score, header.finalScore,
+          (unsigned long long)hash, (unsigned long long)header.finalHash, match ? "match" : "MISMATCH");
+  Profiler::Get().Report(stderr);
+  return match ? 0 : 2;
+}
+
+int main(int argc, char **argv)
+{
+  long ticks = 1000000;
+  float tickRate = 120.0f;
+  int numEnvs = 0;
+  int numThreads = -1;
+  uint64_t seed = 1;
+  long ghostCount = -1; // the classic four
+  int mazeCopies = 1;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    if (!strcmp(argv[i], "--ticks"))
+      ticks = atol(argv[i + 1]);
+    else if (!strcmp(argv[i], "--tick-rate"))
+      tickRate = (float)atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--envs"))
+      numEnvs = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--threads"))
+      numThreads = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed"))
+      seed = strtoull(argv[i + 1], NULL, 10);
+    else if (!strcmp(argv[i], "--ghosts"))
+      ghostCount = atol(argv[i + 1]);
+    else if (!strcmp(argv[i], "--maze"))
+      mazeCopies = std::max(1, atoi(argv[i + 1]));
+    else if (!strcmp(argv[i], "--replay"))
+      return replay(argv[i + 1]);
+    else
+    {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  float deltaTime = 1.0f / tickRate;
+  const std::vector<std::string> maze = mazeCopies > 1 ? tiledMaze(mazeCopies, mazeCopies) : defaultMaze;
+  // scripted input has its own stream so it doesn't shift the games' draws
+  Rng input(seed, 0x1234);
+  const char *traceFile = getenv("PACMAN_TRACE");
+  if (traceFile)
+    Profiler::Get().EnableTrace();
+
+  // a new random steering request every quarter second of game time
+  long inputPeriod = std::max(1L, (long)(tickRate / 4));
+  long resets = 0;
+  float score = 0.0f;
+  long totalTicks = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::shared_ptr<const NavigationTable> navigation;
+
+  std::unique_ptr<ThreadPool> pool;
+  if (numThreads >= 0)
+  {
+    pool.reset(new ThreadPool(numThreads));
+    numEnvs = std::max(numEnvs, pool->size());
+  }
+
+  if (numEnvs > 0)
+  {
+    const int ticksPerStep = 4;
+    BatchEnv batch(numEnvs, tickRate, ticksPerStep, 0, seed);
+    if (ghostCount >= 0)
+      for (Simulation &env : batch.envs)
+        env.roster = ghostRoster(ghostCount);
+    batch.SetLayout(maze);
+    navigation = batch.envs[0].navigation;
+    std::vector<uint8_t> actions(numEnvs, ACTION_NONE);
+    // several chunks per worker so stealing can even out uneven shards
+    int grain = pool ? std::max(1, numEnvs / (pool->size() * 8)) : numEnvs;
+    start = std::chrono::steady_clock::now();
+    if (pool)
+      pool->ResetStats();
+    for (long tick = 0; tick < ticks; tick += ticksPerStep)
+    {
+      for (int i = 0; i < numEnvs; i++)
+        actions[i] = tick % inputPeriod < ticksPerStep ? (uint8_t)(ACTION_RIGHT + input.below(4)) : (uint8_t)ACTION_NONE;
+      if (pool)
+        pool->ParallelFor(numEnvs, grain, [&](int first, int last)
+                          { batch.StepRange(actions.data(), first, last); });
+      else
+        batch.Step(actions.data());
+      for (int i = 0; i < numEnvs; i++)
+      {
+        resets += batch.dones[i];
+        score += batch.rewards[i];
+        totalTicks += batch.ticks[i];
+      }
+      Profiler::Get().Collect();
+    }
+  }
+  else
+  {
+    Simulation sim(seed);
+    if (ghostCount >= 0)
+      sim.roster = ghostRoster(ghostCount);
+    sim.layout = &maze;
+    sim.Reset();
+    navigation = sim.navigation;
+    glm::vec2 desiredDir(0.0f, 0.0f);
+    static const glm::vec2 inputs[] = {
+        {1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    start = std::chrono::steady_clock::now();
+    for (long tick = 0; tick < ticks; tick++)
+    {
+      if (tick % inputPeriod == 0)
+        desiredDir = inputs[input.below(4)];
+      sim.PhysicsUpdate(deltaTime, desiredDir);
+      if (sim.events & EVENT_PACMAN_CAUGHT)
+        resets++;
+      if (sim.state == GAME_WIN)
+      {
+        sim.Reset();
+        resets++;
+      }
+      // drain well before the per-thread ring fills
+      if (tick % 1024 == 1023)
+        Profiler::Get().Collect();
+    }
+    totalTicks = ticks;
+    score = sim.score;
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  double seconds = std::chrono::duration<double>(end - start).count();
+  fprintf(stderr, "ticks: %ld (%.1f Hz, %d envs)\n", totalTicks, tickRate, std::max(numEnvs, 1));
+  fprintf(stderr, "wall time: %.3f s\n", seconds);
+  fprintf(stderr, "ticks per second: %.0f\n", totalTicks / seconds);
+  fprintf(stderr, "resets: %ld, %s score: %.1f\n", resets, numEnvs > 0 ? "total" : "final", score);
+  fprintf(stderr, "maze: %dx%d, %s navigation", navigation->width, navigation->height,
+          navigation->mode == NAVIGATION_DENSE ? "dense" : "flow field");
+  if (navigation->mode == NAVIGATION_DENSE)
+    fprintf(stderr, "\n");
+  else
+    fprintf(stderr, ", %llu fields built\n", (unsigned long long)navigation->fieldsBuilt());
+  if (pool)
+    pool->PrintUtilization(stderr);
+  Profiler::Get().Report(stderr);
+  if (traceFile)
+    Profiler::Get().WriteChromeTrace(traceFile);
+  return 0;
+}
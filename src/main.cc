@@ -2,27 +2,54 @@
 #include <GLFW/glfw3.h>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
+#include <algorithm>
 #include "shader.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "game.h"
+#include "input_journal.h"
 
 glm::vec2 desiredDir; // (-1,0) left; (1,0) right; (0,1) up; (0,-1) down
 
 float window_width = 800.0f;
 float window_height = 600.0f;
 
-float deltaTime = 0.0f; // Time between current frame and last frame
-float lastFrame = 0.0f; // Time of last frame
+float tickRate = 120.0f;    // Simulation ticks per second, independent of the render rate
+float timeScale = 1.0f;     // Above 1 the simulation runs faster than real time
+float maxFrameTime = 0.25f; // Longest frame fed to the simulation, so a stall can't snowball
+float lastFrame = 0.0f;     // Time of last frame
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void process_input(GLFWwindow *window);
 
-int main()
+int main(int argc, char **argv)
 {
+  if (argc > 1)
+  {
+    float rate = (float)atof(argv[1]);
+    if (rate > 0.0f && std::isfinite(rate))
+      tickRate = rate;
+    else
+      fprintf(stderr, "Ignoring tick rate %s, keeping %.0f Hz\n", argv[1], tickRate);
+  }
+  if (argc > 2)
+  {
+    float scale = (float)atof(argv[2]);
+    if (scale > 0.0f && std::isfinite(scale))
+      timeScale = scale;
+    else
+      fprintf(stderr, "Ignoring time scale %s, keeping %.1f\n", argv[2], timeScale);
+  }
+  // "mask" hides eaten pellets through a GPU visibility texture instead of buffer patches
+  BoardRenderMode boardMode = BOARD_PATCHED_INSTANCES;
+  if (argc > 3 && !strcmp(argv[3], "mask"))
+    boardMode = BOARD_VISIBILITY_TEXTURE;
+  const float tickTime = 1.0f / tickRate;
+
   // Initialize GLFW
   if (!glfwInit())
   {
@@ -67,28 +94,67 @@ int main()
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-  Game game;
+  const char *traceFile = getenv("PACMAN_TRACE");
+  if (traceFile)
+    Profiler::Get().EnableTrace();
+
+  // PACMAN_RECORD=path journals every steering request; replay it with build/headless --replay path
+  const uint64_t seed = 0;
+  InputRecorder recorder;
+  const char *recordFile = getenv("PACMAN_RECORD");
+  if (recordFile)
+    recorder.Open(recordFile, tickRate, seed);
+  uint32_t tick = 0;
+
+  Game game(boardMode, seed);
+  float accumulator = 0.0f;
+  lastFrame = glfwGetTime();
 
   while (!glfwWindowShouldClose(window))
   {
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    
-    glm::mat4 projection = glm::ortho(0.0f, window_width, window_height, 0.0f, -1.0f, 1.0f);
-    game.Draw(projection);
+    {
+      PROFILE_ZONE("glfwPollEvents");
+      glfwPollEvents();
+    }
+    process_input(window);
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
     float currentFrame = glfwGetTime();
-    deltaTime = currentFrame - lastFrame;
+    float frameTime = std::min(currentFrame - lastFrame, maxFrameTime);
     lastFrame = currentFrame;
 
-    game.pacman.updateTexture(deltaTime);
+    // the simulation only ever advances in whole fixed ticks, so outcomes
+    // don't depend on how fast we render
+    accumulator += frameTime * timeScale;
+    while (accumulator >= tickTime)
+    {
+      recorder.Record(tick, desiredDir);
+      game.pacman.updateAnimation(tickTime);
+      game.PhysicsUpdate(tickTime, desiredDir);
+      recorder.Settle(desiredDir);
+      tick++;
+      accumulator -= tickTime;
+    }
 
-    process_input(window);
-    game.PhysicsUpdate(deltaTime, desiredDir);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glm::mat4 projection = glm::ortho(0.0f, window_width, window_height, 0.0f, -1.0f, 1.0f);
+    game.Draw(projection, accumulator / tickTime);
+
+    {
+      PROFILE_ZONE("glfwSwapBuffers");
+      glfwSwapBuffers(window);
+    }
+    Profiler::Get().Collect();
   }
 
+  recorder.Close(tick, game.score, game.StateHash());
+
+  // PACMAN_TRACE=path also writes the zones as a Chrome trace
+  Profiler::Get().Report(stdout);
+  if (traceFile)
+    Profiler::Get().WriteChromeTrace(traceFile);
+
   glfwDestroyWindow(window);
   glfwTerminate();
 
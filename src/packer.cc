@@ -0,0 +1,169 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "miniaudio.h"
+#include "asset_pack.h"
+
+// Bakes the game's assets into one pack that the game maps at startup
+// instead of opening and decoding each file.
+//
+//   build/packer OUT [--layer-size N] FILE...
+//
+// .png files are decoded and resampled to the sprite layer size (64, as in
+// TextureArray), .vs/.fs/.glsl files are stored as source and anything else
+// is decoded to f32 PCM by miniaudio. Entries are named by the path given,
+// which must match the path the game loads, e.g. pacman-art/ghosts/inky.png.
+
+static bool endsWith(const std::string &s, const char *suffix)
+{
+  size_t n = strlen(suffix);
+  return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+static bool readFile(const char *path, std::vector<unsigned char> &out)
+{
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  out.resize(size);
+  bool ok = size == 0 || fread(out.data(), 1, size, file) == (size_t)size;
+  fclose(file);
+  return ok;
+}
+
+static bool packTexture(const char *path, int layerSize, AssetPackEntry &entry, std::vector<unsigned char> &payload)
+{
+  int width, height, nrChannels;
+  unsigned char *data = stbi_load(path, &width, &height, &nrChannels, 4);
+  if (!data)
+    return false;
+  entry.type = ASSET_TEXTURE;
+  entry.width = layerSize;
+  entry.height = layerSize;
+  payload.resize((size_t)layerSize * layerSize * 4);
+  resampleRGBA(data, width, height, payload.data(), layerSize);
+  stbi_image_free(data);
+  return true;
+}
+
+static bool packShader(const char *path, AssetPackEntry &entry, std::vector<unsigned char> &payload)
+{
+  if (!readFile(path, payload))
+    return false;
+  entry.type = ASSET_SHADER;
+  payload.push_back(0);
+  return true;
+}
+
+static bool packSound(const char *path, AssetPackEntry &entry, std::vector<unsigned char> &payload)
+{
+  // native channel count and rate; the engine converts at playback
+  ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 0, 0);
+  void *frames = NULL;
+  ma_uint64 frameCount = 0;
+  if (ma_decode_file(path, &config, &frameCount, &frames) != MA_SUCCESS)
+    return false;
+  entry.type = ASSET_SOUND;
+  entry.channels = config.channels;
+  entry.sampleRate = config.sampleRate;
+  entry.frameCount = frameCount;
+  size_t bytes = (size_t)frameCount * config.channels * sizeof(float);
+  payload.assign((unsigned char *)frames, (unsigned char *)frames + bytes);
+  ma_free(frames, NULL);
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 3)
+  {
+    fprintf(stderr, "usage: %s OUT [--layer-size N] FILE...\n", argv[0]);
+    return 1;
+  }
+  const char *outPath = argv[1];
+  int layerSize = 64;
+
+  std::vector<AssetPackEntry> entries;
+  std::vector<std::vector<unsigned char>> payloads;
+  for (int i = 2; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--layer-size") && i + 1 < argc)
+    {
+      layerSize = atoi(argv[++i]);
+      continue;
+    }
+    std::string path = argv[i];
+    AssetPackEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    if (path.size() >= sizeof(entry.name))
+    {
+      fprintf(stderr, "path too long for a pack entry: %s\n", path.c_str());
+      return 1;
+    }
+    strcpy(entry.name, path.c_str());
+
+    std::vector<unsigned char> payload;
+    bool ok;
+    if (endsWith(path, ".png"))
+      ok = packTexture(path.c_str(), layerSize, entry, payload);
+    else if (endsWith(path, ".vs") || endsWith(path, ".fs") || endsWith(path, ".glsl"))
+      ok = packShader(path.c_str(), entry, payload);
+    else
+      ok = packSound(path.c_str(), entry, payload);
+    if (!ok)
+    {
+      fprintf(stderr, "failed to pack %s\n", path.c_str());
+      return 1;
+    }
+    entry.size = payload.size();
+    entries.push_back(entry);
+    payloads.push_back(std::move(payload));
+  }
+
+  AssetPackHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, ASSET_PACK_MAGIC, 4);
+  header.version = ASSET_PACK_VERSION;
+  header.entryCount = (uint32_t)entries.size();
+
+  auto align = [](uint64_t offset)
+  { return (offset + 15) & ~(uint64_t)15; };
+  uint64_t offset = align(sizeof(header) + entries.size() * sizeof(AssetPackEntry));
+  for (auto &entry : entries)
+  {
+    entry.offset = offset;
+    offset = align(offset + entry.size);
+  }
+
+  FILE *out = fopen(outPath, "wb");
+  if (!out)
+  {
+    fprintf(stderr, "failed to open %s\n", outPath);
+    return 1;
+  }
+  fwrite(&header, sizeof(header), 1, out);
+  fwrite(entries.data(), sizeof(AssetPackEntry), entries.size(), out);
+  static const unsigned char padding[16] = {};
+  for (size_t i = 0; i < entries.size(); i++)
+  {
+    fwrite(padding, 1, entries[i].offset - ftell(out), out);
+    fwrite(payloads[i].data(), 1, payloads[i].size(), out);
+  }
+  long written = ftell(out);
+  bool ok = fflush(out) == 0;
+  fclose(out);
+  if (!ok)
+  {
+    fprintf(stderr, "failed to write %s\n", outPath);
+    return 1;
+  }
+  printf("packed %zu assets into %s (%ld bytes)\n", entries.size(), outPath, written);
+  return 0;
+}